@@ -1,9 +1,404 @@
-from flask import Flask, flash, redirect, render_template, request, jsonify
+from flask import Flask, Response, flash, make_response, redirect, render_template, request, jsonify
+from werkzeug.middleware.proxy_fix import ProxyFix
+import hashlib
+import io
+import re
 import subprocess
 import os
+import threading
+from collections import OrderedDict
+
+import metrics
+from engine_protocol import COLUMNS_HEADER, COLUMNS_MAGIC, Histogram, ResultRecord, SharedResults, decode_analyses, parse_spans, parse_timings, read_snapshot_assets
+from tracing import SpanSink, new_trace_id
 
 app = Flask(__name__)
 
+# PROXY HOPS: Reverse proxies in front of the app (Railway's router is one). Their X-Forwarded-For
+# entry becomes request.remote_addr, so per-client bookkeeping sees clients rather than the proxy;
+# set TRUSTED_PROXIES=0 when serving directly, or clients could name any address they like.
+TRUSTED_PROXIES = int(os.environ.get("TRUSTED_PROXIES", "1"))
+if TRUSTED_PROXIES:
+    app.wsgi_app = ProxyFix(app.wsgi_app, x_for=TRUSTED_PROXIES)
+
+# SHARED MEMORY: Results published by a resident engine (./finance_engine --daemon <csv>), readable by every worker.
+shared_results = SharedResults(os.environ.get("ENGINE_SHM", "/risk_engine"))
+
+# TRACE SINK: JSON-lines file receiving every request's spans. Opt-in (set TRACE_SINK to a path):
+# the file is never rotated, so it is meant for investigations, not for running permanently.
+spans = SpanSink(os.environ.get("TRACE_SINK", ""))
+
+# UPLOAD RETENTION: Content-addressed uploads kept on disk (oldest pruned first).
+UPLOAD_DIR = "uploads"
+UPLOAD_KEEP = 64
+# UPLOAD STREAMING: Bytes copied (and hashed) per step when saving an upload.
+UPLOAD_CHUNK = 1 << 20
+
+# RESULT CACHE: Decoded engine results kept per worker, keyed by (dataset digest, asset).
+RESULT_CACHE_SIZE = 512
+
+# SPECULATION: Background --all runs (one per uploader) a worker keeps going at once.
+SPECULATION_SLOTS = 4
+
+# ASSET TYPES: What a requested type may look like: printable ASCII (which asset_key() folds as the
+# engine does), no comma (--assets is a comma list) and no leading '-'. Types reach the engine's
+# argv after '--', so the dash rule only keeps them from ever looking like a switch.
+ASSET_TYPE = re.compile(r"(?!-)[\x20-\x2b\x2d-\x7e]+")
+
+
+class SingleFlight:
+    """
+    REQUEST COALESCING
+    Concurrent calls with the same key share one execution: the first caller (the leader)
+    runs the function, later callers wait for it and receive the same result or exception.
+    A key is forgotten as soon as its flight lands, so results are never served stale.
+    """
+
+    class _Flight:
+        def __init__(self):
+            self.done = threading.Event()
+            self.result = None
+            self.error = None
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._flights = {}
+        # COUNTERS: Executions started, and callers that rode along on one instead.
+        self.leaders = 0
+        self.followers = 0
+        # QUEUE DEPTH: Followers currently blocked on a flight.
+        self.waiting = 0
+
+    def in_flight(self):
+        """Number of executions currently running."""
+        return len(self._flights)
+
+    def do(self, key, function):
+        with self._lock:
+            flight = self._flights.get(key)
+            leader = flight is None
+            if leader:
+                flight = self._flights[key] = self._Flight()
+                self.leaders += 1
+            else:
+                self.followers += 1
+        if not leader:
+            with self._lock:
+                self.waiting += 1
+            flight.done.wait()
+            with self._lock:
+                self.waiting -= 1
+            if flight.error is not None:
+                raise flight.error
+            return flight.result
+        try:
+            flight.result = function()
+            return flight.result
+        except Exception as error:
+            flight.error = error
+            raise
+        finally:
+            with self._lock:
+                del self._flights[key]
+            flight.done.set()
+
+
+engine_flights = SingleFlight()
+
+
+def asset_key(name):
+    """
+    ASSET IDENTITY
+    The form of an asset type results are cached and matched under. The engine finds an
+    asset by a case-folded hash and keeps 19 bytes of its name, so 'equity' and 'EQUITY'
+    are one asset and a record's type is the dataset's spelling, not the requested one.
+    """
+    return name[:19].upper()
+
+
+def store_upload(source):
+    """
+    CONTENT-ADDRESSED STORAGE
+    Saves an upload (bytes, or a file-like object streamed in chunks) under its SHA-256 so
+    identical files share one path and concurrent requests never overwrite each other's
+    data mid-run. Compressed uploads (gzip/zlib) are stored as received: the engine inflates
+    them while parsing. uploads/returns.csv is re-pointed at the latest upload (atomically)
+    for a daemon watching that path.
+    Returns (digest, path).
+    """
+    if isinstance(source, (bytes, bytearray)):
+        source = io.BytesIO(source)
+    os.makedirs(UPLOAD_DIR, exist_ok=True)
+    staging = os.path.join(UPLOAD_DIR, f"upload.{os.getpid()}.{threading.get_ident()}.tmp")
+    hasher = hashlib.sha256()
+    with open(staging, "wb") as handle:
+        while chunk := source.read(UPLOAD_CHUNK):
+            hasher.update(chunk)
+            handle.write(chunk)
+    digest = hasher.hexdigest()
+    path = os.path.join(UPLOAD_DIR, f"{digest}.csv")
+    if os.path.exists(path):
+        os.remove(staging)
+    else:
+        os.replace(staging, path)
+    latest = os.path.join(UPLOAD_DIR, f"returns.csv.{os.getpid()}.{threading.get_ident()}.tmp")
+    os.link(path, latest)
+    os.replace(latest, os.path.join(UPLOAD_DIR, "returns.csv"))
+    # rename() between two links to the same file is a no-op that leaves the source behind.
+    if os.path.lexists(latest):
+        os.remove(latest)
+
+    # PRUNING: An engine that already opened a pruned file keeps reading it (POSIX unlink semantics).
+    stored = [entry for entry in os.scandir(UPLOAD_DIR) if entry.name.endswith(".csv") and len(entry.name) == 68]
+    if len(stored) > UPLOAD_KEEP:
+        stored.sort(key=lambda entry: entry.stat().st_mtime)
+        for entry in stored[:-UPLOAD_KEEP]:
+            try:
+                os.remove(entry.path)
+            except FileNotFoundError:
+                pass
+    return digest, path
+
+
+class DatasetRegistry:
+    """
+    DATASET REGISTRY
+    Each uploaded dataset is parsed once into an engine snapshot (datasets/<id>.snap, where
+    the ID is the upload's SHA-256), which the engine then loads without parsing. Queries
+    name the ID instead of re-sending the file, so switching asset types costs neither the
+    transfer nor the parse.
+
+    Snapshots live on disk (the page cache keeps hot ones in memory) and are shared by every
+    worker. Recency is each snapshot's mtime, touched on every use, so eviction is LRU across
+    workers: whenever the total exceeds the byte budget, the least recently used go first.
+    """
+
+    ID_PATTERN = re.compile(r"[0-9a-f]{64}")
+
+    def __init__(self, directory, budget_bytes):
+        self.directory = directory
+        self.budget_bytes = budget_bytes
+        self.flights = SingleFlight()
+        # COUNTERS: Lookups that found their snapshot, ones that did not, and evictions.
+        self.hits = 0
+        self.misses = 0
+        self.evictions = 0
+
+    def snapshot_path(self, dataset_id):
+        return os.path.join(self.directory, f"{dataset_id}.snap")
+
+    def register(self, payload, columns=False):
+        """
+        Registers an upload (CSV text, or a column upload pre-parsed by the browser when
+        'columns' is set), building its snapshot unless it already exists.
+        Returns (dataset_id, [(asset, day_count), ...]).
+        """
+        dataset_id = hashlib.sha256(payload).hexdigest()
+        path = self.snapshot_path(dataset_id)
+        if os.path.exists(path):
+            os.utime(path)
+            try:
+                return dataset_id, read_snapshot_assets(path)
+            except ValueError:
+                # STALE FORMAT: A snapshot from an older engine is rebuilt from this upload.
+                try:
+                    os.remove(path)
+                except FileNotFoundError:
+                    pass
+        # Concurrent uploads of the same file build one snapshot.
+        self.flights.do(dataset_id, lambda: self._build(payload, path, columns))
+        return dataset_id, read_snapshot_assets(path)
+
+    def _build(self, payload, path, columns):
+        if os.path.exists(path):
+            return
+        os.makedirs(self.directory, exist_ok=True)
+        if columns:
+            # Column uploads are only an input to the snapshot, so they are not kept.
+            source = f"{path}.{os.getpid()}.{threading.get_ident()}.col"
+            with open(source, "wb") as handle:
+                handle.write(payload)
+        else:
+            _, source = store_upload(payload)
+        try:
+            result = subprocess.run(["./finance_engine", source, "--snapshot", path, "--timings"], capture_output=True)
+        finally:
+            if columns:
+                os.remove(source)
+        record_run(result)
+        if result.returncode != 0:
+            raise FileNotFoundError("CSV File not found or empty.")
+        self.evict(keep=path)
+
+    def path(self, dataset_id):
+        """Returns the snapshot path of a registered dataset (marking it used), or None."""
+        if not dataset_id or not self.ID_PATTERN.fullmatch(dataset_id):
+            return None
+        path = self.snapshot_path(dataset_id)
+        try:
+            os.utime(path)
+        except FileNotFoundError:
+            self.misses += 1
+            return None
+        self.hits += 1
+        return path
+
+    def evict(self, keep=None):
+        """Deletes least recently used snapshots until the total fits the budget."""
+        try:
+            entries = [entry for entry in os.scandir(self.directory) if entry.name.endswith(".snap")]
+        except FileNotFoundError:
+            return
+        entries.sort(key=lambda entry: entry.stat().st_mtime)
+        total = sum(entry.stat().st_size for entry in entries)
+        for entry in entries:
+            if total <= self.budget_bytes:
+                break
+            if entry.path == keep:
+                continue
+            try:
+                os.remove(entry.path)
+                self.evictions += 1
+            except FileNotFoundError:
+                pass
+            total -= entry.stat().st_size
+
+
+# MEMORY BUDGET: Total snapshot bytes kept (DATASET_BUDGET_MB, default 512).
+datasets = DatasetRegistry("datasets", int(os.environ.get("DATASET_BUDGET_MB", 512)) * 1024 * 1024)
+
+class ResultCache:
+    """
+    RESULT CACHE
+    Least recently used map of (dataset digest, asset) to the engine's analysis, a
+    (ResultRecord, Histogram) pair. The digest names the file's content, so an entry can
+    never describe different data.
+    """
+
+    def __init__(self, capacity):
+        self.capacity = capacity
+        self._lock = threading.Lock()
+        self._records = OrderedDict()
+        self.hits = 0
+        self.misses = 0
+
+    def get(self, key):
+        with self._lock:
+            record = self._records.get(key)
+            if record is None:
+                self.misses += 1
+                return None
+            self._records.move_to_end(key)
+            self.hits += 1
+            return record
+
+    def put(self, key, record):
+        with self._lock:
+            self._records[key] = record
+            self._records.move_to_end(key)
+            while len(self._records) > self.capacity:
+                self._records.popitem(last=False)
+
+
+class Speculator:
+    """
+    SPECULATIVE PRECOMPUTE
+    Users query several asset types of one file in a row, so each upload starts a
+    background engine run with --all (niced, one thread) that fills the result cache for
+    every asset; the second and later queries are then cache hits. Runs are tracked per
+    uploader (client address, as forwarded by the proxy; see TRUSTED_PROXIES): only an
+    uploader's latest file is worth finishing, so their next upload terminates their own
+    run in progress and nobody else's. At most SPECULATION_SLOTS runs go on at once; past
+    that the oldest is terminated.
+    """
+
+    def __init__(self, cache, slots):
+        self.cache = cache
+        self.slots = slots
+        self._lock = threading.Lock()
+        # RUNS: uploader -> (digest, process), oldest first.
+        self._runs = OrderedDict()
+        # COUNTERS: Runs by outcome.
+        self.outcomes = {"completed": 0, "cancelled": 0, "failed": 0}
+
+    def start(self, digest, path, uploader):
+        with self._lock:
+            # A run over the same file (this uploader's or anyone's) already fills the shared cache.
+            if any(running == digest for running, _ in self._runs.values()):
+                return
+            superseded = self._runs.pop(uploader, None)
+            if superseded is not None:
+                self._cancel(superseded[1])
+            while len(self._runs) >= self.slots:
+                self._cancel(self._runs.popitem(last=False)[1][1])
+            process = subprocess.Popen(
+                ["nice", "-n", "19", "./finance_engine", "--all", "--histogram", "--threads", "1", "--timings", "--", path],
+                stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+            self._runs[uploader] = (digest, process)
+        threading.Thread(target=self._collect, args=(digest, process, uploader), daemon=True).start()
+
+    @staticmethod
+    def _cancel(process):
+        if process.poll() is None:
+            process.terminate()
+
+    def _collect(self, digest, process, uploader):
+        stdout, stderr = process.communicate()
+        with self._lock:
+            if self._runs.get(uploader, (None, None))[1] is process:
+                del self._runs[uploader]
+        if process.returncode < 0:
+            outcome = "cancelled"
+        else:
+            record_run(subprocess.CompletedProcess(process.args, process.returncode, stdout, stderr))
+            try:
+                analyses = decode_analyses(stdout)
+            except ValueError:
+                analyses = []
+            for analysis in analyses:
+                self.cache.put((digest, asset_key(analysis[0].type)), analysis)
+            outcome = "completed" if process.returncode == 0 and analyses else "failed"
+        with self._lock:
+            self.outcomes[outcome] += 1
+
+
+results = ResultCache(RESULT_CACHE_SIZE)
+speculator = Speculator(results, SPECULATION_SLOTS)
+
+# METRICS REGISTRY: Everything /metrics exposes. Engine figures are taken from its --timings report.
+registry = []
+engine_runs = metrics.Counter(registry, "risk_engine_runs_total",
+                              "Engine runs by exit code (0 ok, 1 I/O, 2 math, 3 not found).", ("exit_code",))
+engine_phase_seconds = metrics.Histogram(registry, "risk_engine_phase_seconds",
+                                         "Engine phase latency as measured by the engine.", ("phase",))
+engine_rows = metrics.Counter(registry, "risk_engine_rows_ingested_total", "Rows the engine ingested.")
+engine_paths = metrics.Counter(registry, "risk_engine_paths_simulated_total", "Monte Carlo paths the engine simulated.")
+engine_running = metrics.Gauge(registry, "risk_engine_running", "Engine processes currently running.")
+cache_requests = metrics.Counter(
+    registry, "risk_engine_cache_requests_total",
+    "Lookups by cache and result: 'coalesce' (joined an in-flight run), 'dataset' (registered snapshot found), "
+    "'result' (asset already computed).",
+    ("cache", "result"),
+    sample=lambda: [({"cache": "coalesce", "result": "hit"}, engine_flights.followers),
+                    ({"cache": "coalesce", "result": "miss"}, engine_flights.leaders),
+                    ({"cache": "dataset", "result": "hit"}, datasets.hits),
+                    ({"cache": "dataset", "result": "miss"}, datasets.misses),
+                    ({"cache": "result", "result": "hit"}, results.hits),
+                    ({"cache": "result", "result": "miss"}, results.misses)])
+speculative_runs = metrics.Counter(registry, "risk_engine_speculative_runs_total",
+                                   "Background all-asset runs by outcome.", ("outcome",),
+                                   sample=lambda: [({"outcome": outcome}, count)
+                                                   for outcome, count in speculator.outcomes.items()])
+dataset_evictions = metrics.Counter(registry, "risk_engine_dataset_evictions_total",
+                                    "Dataset snapshots evicted by the memory budget.",
+                                    sample=lambda: [({}, datasets.evictions)])
+queue_depth = metrics.Gauge(
+    registry, "risk_engine_queue_depth",
+    "Work queued per stage: 'flights' (distinct runs in flight), 'waiting' (requests blocked on one).",
+    ("queue",),
+    sample=lambda: [({"queue": "flights"}, engine_flights.in_flight()),
+                    ({"queue": "waiting"}, engine_flights.waiting)])
+
 @app.route("/", methods=["GET"])
 def index():
     """
@@ -22,54 +417,286 @@ def response():
     Orchestrates the lifecycle of a single simulation request.
     """
     if request.method == "POST":
-        # DATA EXTRACTION: Retrieving the 'Asset Type' metadata from the multipart form.
-        type = request.form.get("investment_type")
+        # TRACING: One ID ties this request's spans (and the engine phases it triggers) together;
+        # it is returned in X-Trace-Id so a slow request can be looked up in the sink.
+        trace_id = new_trace_id()
+        with spans.span(trace_id, "request", parent=None, route="/result") as request_span:
+            reply = make_response(simulate(trace_id))
+            request_span["status"] = reply.status_code
+        reply.headers["X-Trace-Id"] = trace_id
+        return reply
+    else:
+        # FALLBACK: Renders index for standard GET requests.
+        return render_template("index.html")
 
-        # FILE BUFFERING: Capturing the uploaded CSV packet from the request stream.
-        data = request.files["file_input_name"]
 
-        # PERSISTENCE: Saving the data to a localized buffer for the C-Engine to access via path.
-        os.makedirs("uploads", exist_ok=True)
-        data.save("uploads/returns.csv")
+def simulate(trace_id):
+    """
+    SIMULATION PIPELINE
+    The body of a /result POST, each stage recorded as a span of 'trace_id'.
+    """
+    # DATA EXTRACTION: Retrieving the 'Asset Type' metadata from the multipart form.
+    type = request.form.get("investment_type")
+    if type is None or not ASSET_TYPE.fullmatch(type):
+        return jsonify({"error": "Invalid asset type."}), 400
 
-        try:
-            # INTER-PROCESS COMMUNICATION (IPC): Passing control to the C-Engine bridge.
-            inv_type, mean, score, wcmin, wcmax = engine("uploads/returns.csv", type)
-
-            # DATA FORMATTING: Preparing raw numerical outputs for UI-friendly string representation.
-            wc_min = f"{wcmin}%"
-            wc_max = f"{wcmax}%"
-            stability = f"{score}%"
-
-        except NameError:
-            # VALIDATION ERROR: Specific handling for non-existent asset categories.
-            return render_template("index.html", error="That asset doesn't exist!")
-        except Exception as e:
-            # SYSTEM ERROR BOUNDARY: Captures and logs pipeline failures (C-crash, FileIO, etc.)
-            print(f"Bridge Error: {e}")
-            return jsonify({"error": str(e)}), 400
-
-        # SERIALIZATION: Returning the calculated insights to the JS fetch() callback as JSON.
-        return jsonify({
-            "type": inv_type,
-            "mean": mean,
-            "stability": stability,
-            "min": wc_min,
-            "max": wc_max,
-        })
+    # DATASET REFERENCE: A registered dataset is named by ID instead of being re-uploaded.
+    dataset_id = request.form.get("dataset_id")
+    if dataset_id:
+        digest, path = dataset_id, datasets.path(dataset_id)
+        if path is None:
+            return jsonify({"error": "Unknown or expired dataset; upload the file again."}), 404
     else:
-        # FALLBACK: Renders index for standard GET requests.
-        return render_template("index.html")
+        # FILE BUFFERING: Capturing the uploaded CSV packet (possibly gzipped) from the request stream.
+        with spans.span(trace_id, "upload"):
+            upload = request.files["file_input_name"]
+
+        # PERSISTENCE: Streaming the data, as sent, under its content hash for the C-Engine to access via path.
+        with spans.span(trace_id, "save") as save_span:
+            digest, path = store_upload(upload.stream)
+            save_span["bytes"] = os.path.getsize(path)
+
+        # SPECULATION: Computing every other asset of this file in the background.
+        speculator.start(digest, path, request.remote_addr)
+
+    try:
+        # INTER-PROCESS COMMUNICATION (IPC): Passing control to the C-Engine bridge.
+        # Identical concurrent requests (same dataset, same asset) share a single engine run,
+        # whose phase spans belong to the trace of the request that started it.
+        key = asset_key(type)
+        with spans.span(trace_id, "engine", asset=type) as engine_span:
+            analysis = results.get((digest, key))
+            engine_span["cached"] = analysis is not None
+            if analysis is None:
+                analysis = engine_flights.do((digest, key), lambda: engine(path, type, trace_id))
+                if analysis[0].type != "N/A":
+                    results.put((digest, key), analysis)
 
+    except NameError:
+        # VALIDATION ERROR: Specific handling for non-existent asset categories.
+        return render_template("index.html", error="That asset doesn't exist!")
+    except Exception as e:
+        # SYSTEM ERROR BOUNDARY: Captures and logs pipeline failures (C-crash, FileIO, etc.)
+        print(f"Bridge Error: {e} (trace {trace_id})")
+        return jsonify({"error": str(e)}), 400
 
-def engine(data, user_query):
+    # SERIALIZATION: Returning the calculated insights to the JS fetch() callback as JSON.
+    with spans.span(trace_id, "response"):
+        return jsonify(analysis_json(*analysis))
+
+
+def analysis_json(record, histogram):
+    """
+    DATA FORMATTING
+    Turns raw numerical outputs into the UI-friendly strings the dashboard shows.
+    """
+    return {
+        "type": record.type,
+        "mean": f"{record.mean:.4f}",
+        "stability": f"{record.stability:.4f}%",
+        "min": f"{record.min_var:.4f}%",
+        "max": f"{record.max_var:.4f}%",
+        # DISTRIBUTION: The engine's histogram of the simulated returns (a few hundred bytes, not the samples).
+        "histogram": histogram_json(histogram, record.worst_case),
+    }
+
+
+@app.route("/batch", methods=["POST"])
+def batch():
+    """
+    MULTI-ASSET REQUEST
+    Results for several asset types of one dataset in a single round trip: the form names
+    the dataset (dataset_id) or carries the file, plus the wanted types in 'types'
+    (comma-separated; empty or absent means every asset in the file). Whatever the result
+    cache lacks is computed by ONE engine run over all the missing types, so the file is
+    loaded once however many types are asked for. Answers {"results": [...]} in request
+    order; a type without a result carries an "error" instead of figures.
+    """
+    trace_id = new_trace_id()
+    with spans.span(trace_id, "request", parent=None, route="/batch") as request_span:
+        reply = make_response(compare(trace_id))
+        request_span["status"] = reply.status_code
+    reply.headers["X-Trace-Id"] = trace_id
+    return reply
+
+
+def compare(trace_id):
+    """
+    BATCH PIPELINE
+    The body of a /batch POST, staged like simulate().
+    """
+    types = [name for name in request.form.get("types", "").split(",") if name]
+    if not all(ASSET_TYPE.fullmatch(name) for name in types):
+        return jsonify({"error": "Invalid asset type."}), 400
+
+    # DATASET REFERENCE: As in /result, a registered dataset spares the upload.
+    dataset_id = request.form.get("dataset_id")
+    if dataset_id:
+        digest, path = dataset_id, datasets.path(dataset_id)
+        if path is None:
+            return jsonify({"error": "Unknown or expired dataset; upload the file again."}), 404
+        # ALL ASSETS: A snapshot lists its assets, so "every asset" can be served from the cache too.
+        if not types:
+            types = [name for name, _ in read_snapshot_assets(path)]
+    else:
+        with spans.span(trace_id, "upload"):
+            upload = request.files.get("file_input_name")
+        if upload is None:
+            return jsonify({"error": "No file uploaded."}), 400
+        with spans.span(trace_id, "save") as save_span:
+            digest, path = store_upload(upload.stream)
+            save_span["bytes"] = os.path.getsize(path)
+
+    try:
+        with spans.span(trace_id, "engine", assets=len(types)) as engine_span:
+            # MATCHING: Results are held under asset_key(), as the engine would match the names.
+            wanted = {asset_key(name): name for name in types}
+            analyses = {key: results.get((digest, key)) for key in wanted}
+            missing = sorted(name for key, name in wanted.items() if analyses[key] is None)
+            engine_span["cached"] = len(wanted) - len(missing)
+            if missing or not types:
+                # One run covers every missing type; identical concurrent batches share it. The key has
+                # its own namespace: a single missing type must not join a /result run, which returns
+                # one analysis rather than a list.
+                for analysis in engine_flights.do(("batch", digest, ",".join(missing)),
+                                                  lambda: engine_batch(path, missing, trace_id)):
+                    key = asset_key(analysis[0].type)
+                    results.put((digest, key), analysis)
+                    analyses[key] = analysis
+    except Exception as e:
+        print(f"Bridge Error: {e} (trace {trace_id})")
+        return jsonify({"error": str(e)}), 400
+
+    with spans.span(trace_id, "response"):
+        return jsonify({"results": [
+            analysis_json(*analyses[asset_key(name)]) if analyses.get(asset_key(name)) is not None
+            else {"type": name, "error": "Not in this dataset, or not enough data points to calculate risk."}
+            for name in (types or list(analyses))
+        ]})
+
+
+def histogram_json(histogram, worst_case):
+    """
+    HISTOGRAM SERIALIZATION
+    Bin edges and counts for the dashboard's canvas, plus the 5% quantile to mark on it;
+    None when the engine produced no histogram.
+    """
+    if histogram is None:
+        return None
+    return {"low": histogram.low, "high": histogram.high, "counts": histogram.counts, "var": worst_case}
+
+
+@app.route("/datasets", methods=["POST"])
+def upload_dataset():
+    """
+    DATASET UPLOAD
+    Ingests a CSV once into the registry and returns its ID and assets; /result then
+    accepts 'dataset_id' in place of the file.
+    """
+    data = request.files.get("file_input_name")
+    if data is None:
+        return jsonify({"error": "No file uploaded."}), 400
+    try:
+        dataset_id, assets = datasets.register(data.read())
+    except Exception as e:
+        print(f"Bridge Error: {e}")
+        return jsonify({"error": str(e)}), 400
+    # SPECULATION: Computing every asset of the new dataset before the first query asks.
+    speculator.start(dataset_id, datasets.snapshot_path(dataset_id), request.remote_addr)
+    return jsonify({
+        "dataset_id": dataset_id,
+        "assets": [{"type": name, "days": days} for name, days in assets],
+    })
+
+
+@app.route("/datasets/columns", methods=["POST"])
+def upload_columns():
+    """
+    PRE-PARSED UPLOAD
+    Registers a dataset the browser already parsed (static/csv_worker.js): the body is a
+    column upload of float32 returns per symbol, which the engine loads without any text
+    parsing. Answers exactly like /datasets.
+    """
+    payload = request.get_data()
+    if len(payload) < COLUMNS_HEADER.size or not payload.startswith(COLUMNS_MAGIC):
+        return jsonify({"error": "Not a column upload."}), 400
+    try:
+        dataset_id, assets = datasets.register(payload, columns=True)
+    except Exception as e:
+        print(f"Bridge Error: {e}")
+        return jsonify({"error": "Malformed column upload."}), 400
+    speculator.start(dataset_id, datasets.snapshot_path(dataset_id), request.remote_addr)
+    return jsonify({
+        "dataset_id": dataset_id,
+        "assets": [{"type": name, "days": days} for name, days in assets],
+    })
+
+
+@app.route("/metrics", methods=["GET"])
+def metrics_endpoint():
+    """
+    PROMETHEUS SCRAPE TARGET
+    Engine outcomes, engine-measured phase latencies, throughput counters, cache hit
+    counts and queue depths of this worker, in the Prometheus text format.
+    """
+    return Response(metrics.render(registry), mimetype="text/plain; version=0.0.4")
+
+
+@app.route("/latest/<asset>", methods=["GET"])
+def latest(asset):
+    """
+    SHARED RESULT LOOKUP
+    Serves the engine daemon's latest published analysis of an asset straight from shared
+    memory: no upload, no subprocess, and the same answer from every worker process.
+    """
+    if not shared_results.available():
+        return jsonify({"error": "The engine daemon is not running."}), 503
+    found = shared_results.result(asset)
+    if found is None:
+        return jsonify({"error": "That asset doesn't exist!"}), 404
+    status, updated_ns, record = found
+    if status == 2:
+        return jsonify({"error": "Math error: Not enough data points to calculate risk."}), 400
+
+    # DATA FORMATTING: Same display strings as /result, plus when the daemon computed them.
+    return jsonify({
+        **analysis_json(record, shared_histogram(asset)),
+        "days": record.day_count,
+        "updated_ns": updated_ns,
+    })
+
+
+def shared_histogram(asset):
+    """The daemon's histogram of an asset as a Histogram, or None."""
+    found = shared_results.histogram(asset)
+    if found is None:
+        return None
+    low, high, counts = found
+    return Histogram(asset, low, high, sum(counts), counts)
+
+
+def engine(data, user_query, trace_id=None):
     """
     CROSS-STACK BRIDGE
     This is the core architectural link between Python (Web) and C (Math).
+    With a trace_id the engine reports its phases as spans, forwarded to the trace sink.
+    Returns the (ResultRecord, Histogram) analysis of the asset.
     """
     # SUBPROCESS EXECUTION: Running the compiled C binary as a separate system process.
     # Passing the CSV path and Asset Type as command-line arguments.
-    result = subprocess.run(["./finance_engine", data, user_query], capture_output=True, text=True)
+    engine_running.inc()
+    try:
+        arguments = ["./finance_engine", "--histogram", "--timings"]
+        if trace_id and spans.path:
+            arguments += ["--trace", trace_id]
+        # SEPARATOR: Nothing after "--" is read as a switch, whatever the path and type hold.
+        arguments += ["--", data, user_query]
+        result = subprocess.run(arguments, capture_output=True)
+    finally:
+        engine_running.inc(-1)
+    record_run(result)
+    for span in parse_spans(result.stderr):
+        spans.write(span)
 
     # EXIT CODE ANALYSIS: Handling custom error signals defined in the C source code.
     if result.returncode == 1:
@@ -79,18 +706,57 @@ def engine(data, user_query):
     elif result.returncode == 3:
         raise NameError("Investment type not found in database.")
 
-    # STDOUT PARSING: Capturing the raw string output from the C 'printf' stream.
-    c_data = result.stdout
-    str_data = c_data.strip()
-
-    # DATA UNPACKING: Splitting the CSV-formatted string returned by C into individual variables.
+    # DATA UNPACKING: Decoding the binary ResultRecord (and its histogram) the engine wrote to stdout
+    # (full precision, no text parsing).
     try:
-        inv_type, mean, stability, wc_min, wc_max = str_data.split(sep=",")
-        return inv_type, mean, stability, wc_min, wc_max
-    except (ValueError, TypeError):
+        return decode_analyses(result.stdout)[0]
+    except (ValueError, IndexError):
         # FAIL-SAFE: Returns zero-state data if the C-Engine output is malformed.
         print("Could Not Retreive output data from engine.")
-        return ("N/A", "0", "0", "0", "0")
+        return ResultRecord("N/A", 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, float("nan")), None
+
+def engine_batch(data, user_queries, trace_id=None):
+    """
+    MULTI-ASSET BRIDGE
+    One engine run (--assets, or --all when 'user_queries' is empty) that loads the dataset
+    once and analyses every requested type. Returns [(ResultRecord, Histogram), ...] for the
+    types that produced a result; a run in which none did returns [].
+    """
+    engine_running.inc()
+    try:
+        arguments = ["./finance_engine", "--histogram", "--timings"]
+        arguments += ["--assets", ",".join(user_queries)] if user_queries else ["--all"]
+        if trace_id and spans.path:
+            arguments += ["--trace", trace_id]
+        arguments += ["--", data]
+        result = subprocess.run(arguments, capture_output=True)
+    finally:
+        engine_running.inc(-1)
+    record_run(result)
+    for span in parse_spans(result.stderr):
+        spans.write(span)
+
+    # EXIT CODE ANALYSIS: 2 and 3 only say that no type had a result, which the caller reports per type.
+    if result.returncode == 1:
+        raise FileNotFoundError("CSV File not found or empty.")
+    if result.returncode != 0:
+        return []
+    return decode_analyses(result.stdout)
+
+def record_run(result):
+    """
+    ENGINE INSTRUMENTATION
+    Folds one engine run into the metrics: its exit code, and the phase durations, rows and
+    simulated paths from the JSON timing line it wrote to stderr.
+    """
+    engine_runs.inc(exit_code=result.returncode)
+    timings = parse_timings(result.stderr)
+    if timings is None:
+        return
+    for phase, measured in timings.get("phases", {}).items():
+        engine_phase_seconds.observe(measured["ns"] / 1e9, phase=phase)
+    engine_rows.inc(timings.get("rows", 0))
+    engine_paths.inc(timings.get("samples", 0))
 
 if __name__ == "__main__":
     port = int(os.environ.get("PORT", 5000))
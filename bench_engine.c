@@ -0,0 +1,496 @@
+/**
+ * Engine Microbenchmark Suite
+ * Times every computational kernel of finance_engine.c in isolation so each one
+ * can be tracked across releases.
+ * * Build: gcc -O2 -pthread bench_engine.c -o bench_engine -lm -lz
+ * * Usage: ./bench_engine [--trials N] [--warmup N] [--size N] [--filter name] [--output file]
+ *
+ * Kernels reached through the dispatch table (moments, RNG, Box-Muller, select,
+ * delimiter scan, Riemann density, elementwise math) are run once per
+ * instruction-set tier this CPU supports and reported as name[tier], e.g.
+ * "mean[avx2]". The math cases (logf, expf, sincosf, sqrtf) run libm on the
+ * scalar tier and simd_math.h elsewhere, over the inputs the engine feeds them,
+ * and also report their max error in ulps against libm in double precision.
+ *
+ * Each benchmark runs untimed warmup trials, then N timed trials. A trial times a
+ * batch of calls and divides by the batch size, so nanosecond kernels like hash()
+ * are not swamped by clock overhead. Results are written as JSON (stdout, or the
+ * --output file, conventionally bench_output.txt) and summarised on stderr.
+ * Cases with a verify hook also check each tier's output ("verified" in the JSON);
+ * a failed check makes the suite exit 1.
+ */
+#define FINANCE_ENGINE_NO_MAIN
+#include "finance_engine.c"
+
+//Defaults chosen so the full suite finishes in a few seconds.
+#define BENCH_TRIALS 200
+#define BENCH_WARMUP 20
+#define BENCH_SIZE 100000
+//items value for kernels that scan the whole shared dataset (resolved to --size).
+#define BENCH_ITEMS_DATASET -1
+
+//A single kernel under test.
+typedef struct {
+    //Stable identifier used in the JSON output; never rename once published.
+    const char *name;
+    //Untimed per-trial setup (restoring inputs a kernel mutates), may be NULL.
+    void (*prepare)(void);
+    //Calls the kernel 'calls' times back to back.
+    void (*run)(int calls);
+    //Calls per timed trial.
+    int calls;
+    //Elements processed per call, used to derive items/sec.
+    long items;
+    //1 = goes through the kernel table, so it is repeated for every supported SIMD tier.
+    int per_tier;
+    //Max error of the current tier's output in ulps, for math kernels; may be NULL.
+    double (*max_ulp)(void);
+    //Checks the current tier's output, returning 0 when it is correct; may be NULL.
+    int (*verify)(void);
+} BenchCase;
+
+//Per-benchmark summary statistics, all in nanoseconds per call.
+typedef struct {
+    double median;
+    double p99;
+    double min;
+    double mean;
+} BenchStats;
+
+//Simulation size rounded up to whole Box-Muller blocks, as synth_data_generator does.
+#define BENCH_SAMPLES ((SIM_SAMPLES + BOX_MULLER_BLOCK - 1) / BOX_MULLER_BLOCK * BOX_MULLER_BLOCK)
+
+//Shared inputs, generated once so every kernel sees identical data.
+float *bench_returns;
+float *bench_scratch;
+float *bench_uniforms;
+//A CSV image in memory, so the parse kernel is measured without disk I/O.
+char *bench_csv;
+size_t bench_csv_length;
+uint64_t *bench_commas;
+uint64_t *bench_newlines;
+//Math kernel inputs over the ranges the engine uses: Box-Muller radii, angles and
+//square roots, and the Riemann scan's exponents.
+float *bench_log_in;
+float *bench_exp_in;
+float *bench_angle_in;
+float *bench_sqrt_in;
+float *bench_math_out;
+float *bench_math_out2;
+int bench_size = BENCH_SIZE;
+float bench_mean;
+float bench_sdev;
+//Assigned by every kernel so the optimiser cannot discard the calls.
+volatile float bench_sink;
+Portfolio bench_portfolio;
+
+static void run_hash(int calls){
+    char symbol[] = "COMMODITY";
+    for (int i = 0; i < calls; i++){
+        bench_sink = hash(symbol);
+    }
+}
+
+static void run_load(int calls){
+    RawData entry;
+    char line[SIZE_LINE];
+    for (int i = 0; i < calls; i++){
+        //load() tokenises in place, so every call needs a fresh copy of the line.
+        strcpy(line, "EQUITY,0.0015\n");
+        load(line, &entry);
+        bench_sink = entry.value;
+    }
+}
+
+static void run_mean(int calls){
+    for (int i = 0; i < calls; i++){
+        bench_sink = mean(bench_returns, bench_size);
+    }
+}
+
+static void run_stand_dev(int calls){
+    for (int i = 0; i < calls; i++){
+        bench_sink = stand_dev(bench_returns, bench_size, bench_mean);
+    }
+}
+
+static void run_synth_data_generator(int calls){
+    for (int i = 0; i < calls; i++){
+        float *generated = synth_data_generator(bench_mean, bench_sdev, SIM_SAMPLES);
+        bench_sink = generated[0];
+        free(generated);
+    }
+}
+
+//analyze() reorders in place; hand it an unsorted copy each trial.
+static void prepare_analyze(void){
+    float *generated = synth_data_generator(bench_mean, bench_sdev, SIM_SAMPLES);
+    memcpy(bench_scratch, generated, sizeof(float) * SIM_SAMPLES);
+    free(generated);
+}
+
+static void run_analyze(int calls){
+    for (int i = 0; i < calls; i++){
+        analyze(bench_scratch, SIM_SAMPLES, &bench_portfolio);
+        bench_sink = bench_portfolio.worst_case;
+    }
+}
+
+//The select may only reorder its input: after analyze() the scratch buffer must
+//still hold exactly the values it was given.
+static int verify_analyze(void){
+    float *before = malloc(sizeof(float) * SIM_SAMPLES);
+    if (before == NULL){
+        return 1;
+    }
+    prepare_analyze();
+    memcpy(before, bench_scratch, sizeof(float) * SIM_SAMPLES);
+    run_analyze(1);
+    qsort(before, SIM_SAMPLES, sizeof(float), &compare);
+    qsort(bench_scratch, SIM_SAMPLES, sizeof(float), &compare);
+    int mismatch = memcmp(before, bench_scratch, sizeof(float) * SIM_SAMPLES) != 0;
+    free(before);
+    return mismatch;
+}
+
+//The pre-dispatch analyze(): a full qsort for one order statistic.
+static void run_qsort_baseline(int calls){
+    for (int i = 0; i < calls; i++){
+        qsort(bench_scratch, SIM_SAMPLES, sizeof(float), &compare);
+        bench_sink = bench_scratch[(int)(SIM_SAMPLES * VAR_LEVEL) - 1];
+    }
+}
+
+static void run_scan_delimiters(int calls){
+    for (int i = 0; i < calls; i++){
+        kernels.scan_delimiters(bench_csv, bench_csv_length, bench_commas, bench_newlines);
+        bench_sink = (float)bench_newlines[0];
+    }
+}
+
+static void run_uniforms(int calls){
+    for (int i = 0; i < calls; i++){
+        kernels.uniforms(&engine_rng, bench_uniforms, BENCH_SAMPLES);
+        bench_sink = bench_uniforms[0];
+    }
+}
+
+static void prepare_box_muller(void){
+    kernels.uniforms(&engine_rng, bench_uniforms, BENCH_SAMPLES);
+}
+
+static void run_box_muller(int calls){
+    for (int i = 0; i < calls; i++){
+        kernels.box_muller(bench_uniforms, bench_scratch, BENCH_SAMPLES, bench_mean, bench_sdev);
+        bench_sink = bench_scratch[0];
+    }
+}
+
+static void run_log(int calls){
+    for (int i = 0; i < calls; i++){
+        kernels.log_array(bench_log_in, bench_math_out, BENCH_SAMPLES);
+        bench_sink = bench_math_out[0];
+    }
+}
+
+static void run_exp(int calls){
+    for (int i = 0; i < calls; i++){
+        kernels.exp_array(bench_exp_in, bench_math_out, BENCH_SAMPLES);
+        bench_sink = bench_math_out[0];
+    }
+}
+
+static void run_sincos(int calls){
+    for (int i = 0; i < calls; i++){
+        kernels.sincos_array(bench_angle_in, bench_math_out, bench_math_out2, BENCH_SAMPLES);
+        bench_sink = bench_math_out[0];
+    }
+}
+
+static void run_sqrt(int calls){
+    for (int i = 0; i < calls; i++){
+        kernels.sqrt_array(bench_sqrt_in, bench_math_out, BENCH_SAMPLES);
+        bench_sink = bench_math_out[0];
+    }
+}
+
+/**
+ * Error of one float result in units of the last place of the exact value.
+ */
+static double ulp_error(float got, double exact){
+    int exponent;
+    frexp(exact, &exponent);
+    //Below FLT_MIN the spacing is fixed at the smallest subnormal.
+    if (exponent < -125){
+        exponent = -125;
+    }
+    return fabs(got - exact) / ldexp(1.0, exponent - 24);
+}
+
+static double log_ulp(void){
+    double worst = 0;
+    run_log(1);
+    for (int i = 0; i < BENCH_SAMPLES; i++){
+        worst = fmax(worst, ulp_error(bench_math_out[i], log((double)bench_log_in[i])));
+    }
+    return worst;
+}
+
+static double exp_ulp(void){
+    double worst = 0;
+    run_exp(1);
+    for (int i = 0; i < BENCH_SAMPLES; i++){
+        worst = fmax(worst, ulp_error(bench_math_out[i], exp((double)bench_exp_in[i])));
+    }
+    return worst;
+}
+
+static double sincos_ulp(void){
+    double worst = 0;
+    run_sincos(1);
+    for (int i = 0; i < BENCH_SAMPLES; i++){
+        worst = fmax(worst, ulp_error(bench_math_out[i], sin((double)bench_angle_in[i])));
+        worst = fmax(worst, ulp_error(bench_math_out2[i], cos((double)bench_angle_in[i])));
+    }
+    return worst;
+}
+
+static double sqrt_ulp(void){
+    double worst = 0;
+    run_sqrt(1);
+    for (int i = 0; i < BENCH_SAMPLES; i++){
+        worst = fmax(worst, ulp_error(bench_math_out[i], sqrt((double)bench_sqrt_in[i])));
+    }
+    return worst;
+}
+
+static void run_rieman(int calls){
+    for (int i = 0; i < calls; i++){
+        rieman(bench_returns, bench_mean, bench_sdev, &bench_portfolio);
+        bench_sink = bench_portfolio.worst_case_rieman;
+    }
+}
+
+//The registry: add new kernels (and faster variants of old ones) here.
+BenchCase bench_cases[] = {
+    {"hash", NULL, run_hash, 1000, 1, 0, NULL, NULL},
+    {"load", NULL, run_load, 1000, 1, 0, NULL, NULL},
+    {"scan_delimiters", NULL, run_scan_delimiters, 1, READ_BLOCK, 1, NULL, NULL},
+    {"mean", NULL, run_mean, 1, BENCH_ITEMS_DATASET, 1, NULL, NULL},
+    {"stand_dev", NULL, run_stand_dev, 1, BENCH_ITEMS_DATASET, 1, NULL, NULL},
+    {"uniforms", NULL, run_uniforms, 1, BENCH_SAMPLES, 1, NULL, NULL},
+    {"logf", NULL, run_log, 1, BENCH_SAMPLES, 1, log_ulp, NULL},
+    {"expf", NULL, run_exp, 1, BENCH_SAMPLES, 1, exp_ulp, NULL},
+    {"sincosf", NULL, run_sincos, 1, BENCH_SAMPLES, 1, sincos_ulp, NULL},
+    {"sqrtf", NULL, run_sqrt, 1, BENCH_SAMPLES, 1, sqrt_ulp, NULL},
+    {"box_muller", prepare_box_muller, run_box_muller, 1, BENCH_SAMPLES, 1, NULL, NULL},
+    {"synth_data_generator", NULL, run_synth_data_generator, 1, SIM_SAMPLES, 1, NULL, NULL},
+    {"analyze", prepare_analyze, run_analyze, 1, SIM_SAMPLES, 1, NULL, verify_analyze},
+    {"qsort_baseline", prepare_analyze, run_qsort_baseline, 1, SIM_SAMPLES, 0, NULL, NULL},
+    {"rieman", NULL, run_rieman, 1, 1, 1, NULL, NULL},
+};
+
+/**
+ * Comparison utility for qsort on trial durations.
+ */
+static int compare_double(const void *a, const void *b){
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+/**
+ * Runs one benchmark and summarises its trials.
+ * * @param bench: The kernel under test.
+ * @param trials: Number of timed trials.
+ * @param warmup: Number of untimed trials run first (caches, branch predictors, page faults).
+ * @return: Median, p99, min and mean nanoseconds per call.
+ */
+static BenchStats run_case(BenchCase *bench, int trials, int warmup){
+    double *samples = malloc(sizeof(double) * trials);
+    BenchStats stats = {0};
+
+    for (int i = 0; i < warmup + trials; i++){
+        if (bench->prepare != NULL){
+            bench->prepare();
+        }
+        long long start = monotonic_ns();
+        bench->run(bench->calls);
+        long long elapsed = monotonic_ns() - start;
+        if (i >= warmup){
+            samples[i - warmup] = (double)elapsed / bench->calls;
+        }
+    }
+
+    qsort(samples, trials, sizeof(double), &compare_double);
+    stats.median = samples[trials / 2];
+    //Nearest-rank percentile, so p99 is always an observed trial.
+    stats.p99 = samples[(int)ceil(trials * 0.99) - 1];
+    stats.min = samples[0];
+    for (int i = 0; i < trials; i++){
+        stats.mean += samples[i];
+    }
+    stats.mean /= trials;
+    free(samples);
+    return stats;
+}
+
+int main(int argc, char* argv[]){
+    int trials = BENCH_TRIALS;
+    int warmup = BENCH_WARMUP;
+    const char *filter = NULL;
+    FILE *output = stdout;
+
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "--trials") == 0 && i + 1 < argc){
+            trials = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc){
+            warmup = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc){
+            bench_size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc){
+            filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc){
+            if ((output = fopen(argv[++i], "w")) == NULL){
+                return 1;
+            }
+        }
+        else{
+            fprintf(stderr, "usage: %s [--trials N] [--warmup N] [--size N] [--filter name] [--output file]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (trials < 1 || warmup < 0 || bench_size < 2){
+        return 1;
+    }
+
+    //A fixed seed keeps the inputs identical from run to run and release to release.
+    rng_seed(&engine_rng, 42);
+    kernels_init();
+    const EngineKernels best = kernels;
+    bench_returns = synth_data_generator(0.0005f, 0.02f, SIM_SAMPLES);
+    bench_scratch = malloc(sizeof(float) * BENCH_SAMPLES);
+    bench_uniforms = malloc(sizeof(float) * BENCH_SAMPLES);
+    bench_csv = malloc(READ_BLOCK);
+    bench_commas = malloc(sizeof(uint64_t) * (READ_BLOCK / 64 + 1));
+    bench_newlines = malloc(sizeof(uint64_t) * (READ_BLOCK / 64 + 1));
+    bench_log_in = malloc(sizeof(float) * BENCH_SAMPLES);
+    bench_exp_in = malloc(sizeof(float) * BENCH_SAMPLES);
+    bench_angle_in = malloc(sizeof(float) * BENCH_SAMPLES);
+    bench_sqrt_in = malloc(sizeof(float) * BENCH_SAMPLES);
+    bench_math_out = malloc(sizeof(float) * BENCH_SAMPLES);
+    bench_math_out2 = malloc(sizeof(float) * BENCH_SAMPLES);
+    if (bench_returns == NULL || bench_scratch == NULL || bench_uniforms == NULL
+        || bench_csv == NULL || bench_commas == NULL || bench_newlines == NULL
+        || bench_log_in == NULL || bench_exp_in == NULL || bench_angle_in == NULL
+        || bench_sqrt_in == NULL || bench_math_out == NULL || bench_math_out2 == NULL){
+        return 1;
+    }
+    kernels.uniforms(&engine_rng, bench_log_in, BENCH_SAMPLES);
+    for (int i = 0; i < BENCH_SAMPLES; i++){
+        //Riemann exponents run from -0.5*5^2 (the scan's start) up to 0.
+        bench_exp_in[i] = -12.5f * bench_log_in[i];
+        bench_angle_in[i] = (float)(PI*2) * bench_log_in[i];
+        bench_sqrt_in[i] = -2 * logf(bench_log_in[i]);
+    }
+    //Fill the CSV image with realistic rows until the block is full.
+    while (bench_csv_length + SIZE_LINE < READ_BLOCK){
+        int row = (int)(bench_csv_length / 16);
+        bench_csv_length += sprintf(bench_csv + bench_csv_length, "%s,%.6f\n",
+                                    (row % 2) ? "EQUITY" : "CRYPTO", bench_returns[row % SIM_SAMPLES]);
+    }
+    //Tile the generator output up to the requested dataset size.
+    float *tiled = malloc(sizeof(float) * bench_size);
+    if (tiled == NULL){
+        return 1;
+    }
+    for (int i = 0; i < bench_size; i++){
+        tiled[i] = bench_returns[i % SIM_SAMPLES];
+    }
+    free(bench_returns);
+    bench_returns = tiled;
+    bench_mean = mean(bench_returns, bench_size);
+    bench_sdev = stand_dev(bench_returns, bench_size, bench_mean);
+
+    fprintf(output, "{\"suite\":\"bench_engine\",\"trials\":%d,\"warmup\":%d,\"size\":%d,\"results\":[",
+            trials, warmup, bench_size);
+    int first = 1;
+    //Set when a verify hook rejects a tier's output; the suite then exits 1.
+    int failed = 0;
+    for (size_t c = 0; c < sizeof(bench_cases) / sizeof(bench_cases[0]); c++){
+        BenchCase *bench = &bench_cases[c];
+        if (filter != NULL && strstr(bench->name, filter) == NULL){
+            continue;
+        }
+        if (bench->items == BENCH_ITEMS_DATASET){
+            bench->items = bench_size;
+        }
+        if (bench->items == READ_BLOCK){
+            bench->items = (long)bench_csv_length;
+        }
+        for (int tier = 0; tier < SIMD_TIER_COUNT; tier++){
+            const EngineKernels *table = kernels_for_tier(tier);
+            char name[64];
+            //Tier-independent kernels run once, on the tier the engine would pick.
+            if (!bench->per_tier){
+                if (tier > 0){
+                    break;
+                }
+                kernels = best;
+                snprintf(name, sizeof(name), "%s", bench->name);
+            }
+            else if (table == NULL){
+                continue;
+            }
+            else{
+                kernels = *table;
+                snprintf(name, sizeof(name), "%s[%s]", bench->name, table->name);
+            }
+            BenchStats stats = run_case(bench, trials, warmup);
+            double items_per_sec = stats.median > 0 ? bench->items / (stats.median / 1e9) : 0;
+
+            fprintf(output, "%s{\"name\":\"%s\",\"calls_per_trial\":%d,\"items_per_call\":%ld,"
+                    "\"median_ns\":%.1f,\"p99_ns\":%.1f,\"min_ns\":%.1f,\"mean_ns\":%.1f,\"items_per_sec\":%.1f",
+                    first ? "" : ",", name, bench->calls, bench->items,
+                    stats.median, stats.p99, stats.min, stats.mean, items_per_sec);
+            fprintf(stderr, "%-28s median %12.1f ns   p99 %12.1f ns   %14.1f items/s",
+                    name, stats.median, stats.p99, items_per_sec);
+            if (bench->max_ulp != NULL){
+                double ulp = bench->max_ulp();
+                fprintf(output, ",\"max_ulp\":%.3f", ulp);
+                fprintf(stderr, "   %6.3f ulp", ulp);
+            }
+            if (bench->verify != NULL){
+                int ok = bench->verify() == 0;
+                fprintf(output, ",\"verified\":%s", ok ? "true" : "false");
+                fprintf(stderr, "   %s", ok ? "ok" : "WRONG OUTPUT");
+                failed |= !ok;
+            }
+            fprintf(output, "}");
+            fprintf(stderr, "\n");
+            first = 0;
+        }
+    }
+    fprintf(output, "]}\n");
+
+    if (output != stdout){
+        fclose(output);
+    }
+    free(bench_returns);
+    free(bench_scratch);
+    free(bench_uniforms);
+    free(bench_csv);
+    free(bench_log_in);
+    free(bench_exp_in);
+    free(bench_angle_in);
+    free(bench_sqrt_in);
+    free(bench_math_out);
+    free(bench_math_out2);
+    free(bench_commas);
+    free(bench_newlines);
+    return failed;
+}
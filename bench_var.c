@@ -0,0 +1,311 @@
+/**
+ * VaR Estimator Accuracy-vs-Cost Benchmark
+ * Measures how far each 5% Value-at-Risk estimator lands from the exact quantile of
+ * a known return distribution, and what it costs, so production defaults can be
+ * picked from a Pareto table instead of by feel.
+ * * Build: gcc -O2 -pthread bench_var.c -o bench_var -lm -lz
+ * * Usage: ./bench_var [--history N] [--replications R] [--seed S] [--output file]
+ *
+ * For every (distribution, estimator, path count) cell the benchmark draws R
+ * independent histories of N returns from the distribution, runs the estimator
+ * the way main() does (fit mean and deviation, then estimate), and reports the
+ * mean absolute error against the exact 5% quantile plus the median wall time.
+ * Errors include model error: the engine fits a normal, so t and skewed data
+ * expose the cost of that assumption, not only Monte Carlo noise.
+ */
+#define FINANCE_ENGINE_NO_MAIN
+#include "finance_engine.c"
+
+#define HISTORY_DAYS 2500
+#define REPLICATIONS 50
+//Degrees of freedom of the heavy-tailed test distribution (closed-form quantile at 4).
+#define T_DOF 4
+//Skew-normal shape; negative puts the long tail on the loss side.
+#define SKEW_ALPHA -4.0
+#define TWO_PI 6.283185307179586
+
+//A return distribution with a known exact VaR_LEVEL quantile.
+typedef struct {
+    const char *name;
+    //Draws one return.
+    double (*sample)(void);
+    //Exact VaR_LEVEL quantile, filled in at start-up.
+    double exact;
+} TestDistribution;
+
+//Inputs an estimator needs: the raw history and its fitted moments.
+typedef struct {
+    float *history;
+    int count;
+    float mean;
+    float sdev;
+    //Simulation size; ignored by estimators that do not simulate.
+    int paths;
+} EstimatorInput;
+
+//One VaR estimator; 'simulates' marks the ones swept over path counts.
+typedef struct {
+    const char *name;
+    float (*estimate)(EstimatorInput *input);
+    int simulates;
+} Estimator;
+
+//One row of the result table.
+typedef struct {
+    const char *distribution;
+    const char *estimator;
+    int paths;
+    double mean_abs_error;
+    double median_ns;
+    int pareto;
+} Cell;
+
+//xorshift64* drives the test distributions, independent of the engine's own generator.
+unsigned long long dist_state = 88172645463325252ULL;
+
+static double uniform01(void){
+    dist_state ^= dist_state >> 12;
+    dist_state ^= dist_state << 25;
+    dist_state ^= dist_state >> 27;
+    return ((dist_state * 2685821657736338717ULL >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+static double standard_normal(void){
+    return sqrt(-2.0 * log(uniform01())) * cos(TWO_PI * uniform01());
+}
+
+//Daily-return scale shared by every distribution so errors are comparable.
+#define LOC 0.0005
+#define SCALE 0.02
+
+static double sample_normal(void){
+    return LOC + SCALE * standard_normal();
+}
+
+static double sample_student_t(void){
+    //t = Z / sqrt(chi2/dof); an integer dof lets chi2 be a plain sum of squares.
+    double chi2 = 0;
+    for (int i = 0; i < T_DOF; i++){
+        double z = standard_normal();
+        chi2 += z * z;
+    }
+    return LOC + SCALE * standard_normal() / sqrt(chi2 / T_DOF);
+}
+
+static double sample_skew_normal(void){
+    //Azzalini's construction: delta*|U0| + sqrt(1-delta^2)*U1.
+    double delta = SKEW_ALPHA / sqrt(1.0 + SKEW_ALPHA * SKEW_ALPHA);
+    double u0 = standard_normal();
+    double u1 = standard_normal();
+    return LOC + SCALE * (delta * fabs(u0) + sqrt(1.0 - delta * delta) * u1);
+}
+
+/**
+ * Exact quantile of Student-t with 4 degrees of freedom (closed form).
+ */
+static double student_t4_quantile(double p){
+    double a = 4.0 * p * (1.0 - p);
+    double q = cos(acos(sqrt(a)) / 3.0) / sqrt(a);
+    return (p < 0.5 ? -2.0 : 2.0) * sqrt(q - 1.0);
+}
+
+/**
+ * Skew-normal CDF by Simpson integration of 2*phi(x)*Phi(alpha*x); the density is
+ * negligible below -12, and 20,000 panels put the error far below any estimator's.
+ */
+static double skew_normal_cdf(double x){
+    const int panels = 20000;
+    double lo = -12.0;
+    double h = (x - lo) / panels;
+    double total = 0;
+    for (int i = 0; i <= panels; i++){
+        double t = lo + i * h;
+        double pdf = 2.0 * exp(-0.5 * t * t) / sqrt(TWO_PI) * 0.5 * erfc(-SKEW_ALPHA * t / sqrt(2.0));
+        total += pdf * ((i == 0 || i == panels) ? 1 : (i % 2 ? 4 : 2));
+    }
+    return total * h / 3.0;
+}
+
+static double skew_normal_quantile(double p){
+    double lo = -12.0;
+    double hi = 12.0;
+    for (int i = 0; i < 80; i++){
+        double mid = 0.5 * (lo + hi);
+        if (skew_normal_cdf(mid) < p){
+            lo = mid;
+        }
+        else{
+            hi = mid;
+        }
+    }
+    return 0.5 * (lo + hi);
+}
+
+TestDistribution distributions[] = {
+    {"normal", sample_normal, 0},
+    {"student_t4", sample_student_t, 0},
+    {"skew_normal", sample_skew_normal, 0},
+};
+
+//Scratch buffer for estimators that must not reorder the caller's history.
+float *scratch;
+Portfolio result;
+
+static float estimate_monte_carlo_select(EstimatorInput *input){
+    float *generated = synth_data_generator(input->mean, input->sdev, input->paths);
+    analyze(generated, input->paths, &result);
+    free(generated);
+    return result.worst_case;
+}
+
+static float estimate_rieman(EstimatorInput *input){
+    rieman(input->history, input->mean, input->sdev, &result);
+    return result.worst_case_rieman;
+}
+
+//Closed-form normal quantile: what the two normal-fit estimators converge to.
+static float estimate_analytic_normal(EstimatorInput *input){
+    return input->mean + Z_VAR_LEVEL * input->sdev;
+}
+
+//Empirical quantile of the history itself, free of the normal assumption.
+static float estimate_historical(EstimatorInput *input){
+    memcpy(scratch, input->history, sizeof(float) * input->count);
+    analyze(scratch, input->count, &result);
+    return result.worst_case;
+}
+
+//The registry: add new VaR modes here as they land.
+Estimator estimators[] = {
+    {"monte_carlo_select", estimate_monte_carlo_select, 1},
+    {"rieman", estimate_rieman, 0},
+    {"analytic_normal", estimate_analytic_normal, 0},
+    {"historical", estimate_historical, 0},
+};
+
+int path_counts[] = {1000, 10000, 100000, 1000000};
+
+static int compare_double(const void *a, const void *b){
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+/**
+ * Runs one estimator over R fresh histories of one distribution.
+ * * @return: The filled result cell (pareto flag computed later).
+ */
+static Cell run_cell(TestDistribution *dist, Estimator *est, int paths, int history_days, int replications){
+    float *history = malloc(sizeof(float) * history_days);
+    double *times = malloc(sizeof(double) * replications);
+    Cell cell = {dist->name, est->name, est->simulates ? paths : 0, 0, 0, 0};
+
+    for (int r = 0; r < replications; r++){
+        for (int i = 0; i < history_days; i++){
+            history[i] = (float)dist->sample();
+        }
+        EstimatorInput input = {history, history_days, 0, 0, paths};
+        //Timing covers the fit as well, matching the work main() does per request.
+        long long start = monotonic_ns();
+        input.mean = mean(history, history_days);
+        input.sdev = stand_dev(history, history_days, input.mean);
+        float estimate = est->estimate(&input);
+        times[r] = (double)(monotonic_ns() - start);
+        cell.mean_abs_error += fabs(estimate - dist->exact);
+    }
+    cell.mean_abs_error /= replications;
+    qsort(times, replications, sizeof(double), &compare_double);
+    cell.median_ns = times[replications / 2];
+    free(history);
+    free(times);
+    return cell;
+}
+
+int main(int argc, char* argv[]){
+    int history_days = HISTORY_DAYS;
+    int replications = REPLICATIONS;
+    FILE *output = stdout;
+
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "--history") == 0 && i + 1 < argc){
+            history_days = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--replications") == 0 && i + 1 < argc){
+            replications = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc){
+            dist_state = strtoull(argv[++i], NULL, 10) | 1;
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc){
+            if ((output = fopen(argv[++i], "w")) == NULL){
+                return 1;
+            }
+        }
+        else{
+            fprintf(stderr, "usage: %s [--history N] [--replications R] [--seed S] [--output file]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (history_days < 20 || replications < 1){
+        return 1;
+    }
+    rng_seed(&engine_rng, dist_state);
+    kernels_init();
+    scratch = malloc(sizeof(float) * history_days);
+
+    distributions[0].exact = LOC + SCALE * Z_VAR_LEVEL;
+    distributions[1].exact = LOC + SCALE * student_t4_quantile(VAR_LEVEL);
+    distributions[2].exact = LOC + SCALE * skew_normal_quantile(VAR_LEVEL);
+
+    int n_dist = sizeof(distributions) / sizeof(distributions[0]);
+    int n_est = sizeof(estimators) / sizeof(estimators[0]);
+    int n_paths = sizeof(path_counts) / sizeof(path_counts[0]);
+    Cell *cells = malloc(sizeof(Cell) * n_dist * n_est * n_paths);
+    int n_cells = 0;
+
+    for (int d = 0; d < n_dist; d++){
+        for (int e = 0; e < n_est; e++){
+            for (int p = 0; p < (estimators[e].simulates ? n_paths : 1); p++){
+                cells[n_cells++] = run_cell(&distributions[d], &estimators[e], path_counts[p],
+                                            history_days, replications);
+            }
+        }
+    }
+
+    //A cell is Pareto-optimal if no cell of the same distribution is both faster and more accurate.
+    for (int i = 0; i < n_cells; i++){
+        cells[i].pareto = 1;
+        for (int j = 0; j < n_cells; j++){
+            if (i != j && cells[j].distribution == cells[i].distribution
+                && cells[j].median_ns <= cells[i].median_ns && cells[j].mean_abs_error <= cells[i].mean_abs_error
+                && (cells[j].median_ns < cells[i].median_ns || cells[j].mean_abs_error < cells[i].mean_abs_error)){
+                cells[i].pareto = 0;
+                break;
+            }
+        }
+    }
+
+    fprintf(stderr, "%-12s %-18s %8s %14s %14s %s\n", "dist", "estimator", "paths", "abs_error", "median_ns", "pareto");
+    fprintf(output, "{\"suite\":\"bench_var\",\"var_level\":%.2f,\"history\":%d,\"replications\":%d,\"distributions\":{",
+            VAR_LEVEL, history_days, replications);
+    for (int d = 0; d < n_dist; d++){
+        fprintf(output, "%s\"%s\":{\"exact_quantile\":%.8f}", d ? "," : "", distributions[d].name, distributions[d].exact);
+    }
+    fprintf(output, "},\"results\":[");
+    for (int i = 0; i < n_cells; i++){
+        fprintf(stderr, "%-12s %-18s %8d %14.6f %14.0f %s\n", cells[i].distribution, cells[i].estimator,
+                cells[i].paths, cells[i].mean_abs_error, cells[i].median_ns, cells[i].pareto ? "*" : "");
+        fprintf(output, "%s{\"distribution\":\"%s\",\"estimator\":\"%s\",\"paths\":%d,"
+                "\"mean_abs_error\":%.8f,\"median_ns\":%.0f,\"pareto\":%s}",
+                i ? "," : "", cells[i].distribution, cells[i].estimator, cells[i].paths,
+                cells[i].mean_abs_error, cells[i].median_ns, cells[i].pareto ? "true" : "false");
+    }
+    fprintf(output, "]}\n");
+
+    if (output != stdout){
+        fclose(output);
+    }
+    free(cells);
+    free(scratch);
+    return 0;
+}
@@ -0,0 +1,314 @@
+"""
+ENGINE RESULT PROTOCOL
+Decoder for the binary result records the C-Engine writes to stdout (ResultRecord in
+finance_engine.c). Every record is a fixed-layout little-endian struct:
+
+    offset  type       field
+    0       uint32     length             bytes after this field (92 for version 2)
+    4       uint16     version            RESULT_SCHEMA_VERSION
+    6       uint16     kind               0 (a HistogramRecord has 1 here)
+    8       char[20]   type               NUL-padded asset name
+    28      uint32     day_count
+    32      float64    mean
+    40      float64    stability          percent
+    48      float64    min_var            percent
+    56      float64    max_var            percent
+    64      float64    std_dev
+    72      float64    worst_case         Monte Carlo 5% quantile
+    80      float64    worst_case_rieman  Riemann-scan 5% quantile
+    88      float64    worst_case_historical  exact 5% quantile of the history (--out-of-core; NaN otherwise)
+
+The length prefix frames a run of records; the version guards against a binary built
+from a different schema. Run the engine with --csv for the legacy text line instead.
+
+With --histogram each result is followed by a HistogramRecord of the asset's simulated
+returns (312 bytes): the same first 8 bytes with kind 1, then the asset name, uint32 bins,
+float64 low and high, uint32 total, uint32 reserved and 'bins' uint32 counts of equal-width
+bins over [low, high) (samples outside are counted in the edge bins).
+"""
+import array
+import json
+import mmap
+import os
+import struct
+from collections import namedtuple
+
+RESULT_SCHEMA_VERSION = 2
+RESULT_STRUCT = struct.Struct("<IHH20sI8d")
+RESULT_FIELDS = ("type", "day_count", "mean", "stability", "min_var", "max_var",
+                 "std_dev", "worst_case", "worst_case_rieman", "worst_case_historical")
+ResultRecord = namedtuple("ResultRecord", RESULT_FIELDS)
+
+RECORD_KIND_RESULT = 0
+RECORD_KIND_HISTOGRAM = 1
+HISTOGRAM_BINS = 64
+HISTOGRAM_STRUCT = struct.Struct(f"<IHH20sIddII{HISTOGRAM_BINS}I")
+Histogram = namedtuple("Histogram", ("type", "low", "high", "total", "counts"))
+
+
+def decode_results(payload):
+    """
+    RECORD DECODER
+    Yields one ResultRecord (or Histogram, for --histogram runs) per record in a bytes-like
+    payload. Fields are unpacked straight from a memoryview, so the payload itself is never
+    copied or split. Raises ValueError on a truncated record or an unknown schema version.
+    """
+    view = memoryview(payload)
+    offset = 0
+    while offset < len(view):
+        if len(view) - offset < 8:
+            raise ValueError("truncated result record header")
+        length, version, kind = struct.unpack_from("<IHH", view, offset)
+        if version != RESULT_SCHEMA_VERSION:
+            raise ValueError(f"unsupported result schema version {version}")
+        layout = HISTOGRAM_STRUCT if kind == RECORD_KIND_HISTOGRAM else RESULT_STRUCT
+        if kind not in (RECORD_KIND_RESULT, RECORD_KIND_HISTOGRAM) or length != layout.size - 4 \
+                or offset + 4 + length > len(view):
+            raise ValueError("truncated or malformed result record")
+        if kind == RECORD_KIND_HISTOGRAM:
+            _, _, _, name, _, low, high, total, _, *counts = HISTOGRAM_STRUCT.unpack_from(view, offset)
+            yield Histogram(name.split(b"\0", 1)[0].decode("utf-8", "replace"), low, high, total, counts)
+        else:
+            _, _, _, name, day_count, *values = RESULT_STRUCT.unpack_from(view, offset)
+            yield ResultRecord(name.split(b"\0", 1)[0].decode("utf-8", "replace"), day_count, *values)
+        offset += 4 + length
+
+
+def decode_analyses(payload):
+    """
+    ANALYSIS PAIRING
+    Returns [(ResultRecord, Histogram or None), ...]: each result with the histogram that
+    follows it in a --histogram run.
+    """
+    analyses = []
+    for item in decode_results(payload):
+        if isinstance(item, Histogram):
+            if analyses and analyses[-1][0].type == item.type and analyses[-1][1] is None:
+                analyses[-1] = (analyses[-1][0], item)
+        else:
+            analyses.append((item, None))
+    return analyses
+
+
+def results_array(payload):
+    """
+    NUMPY VIEW
+    Returns the records as a numpy structured array that aliases the payload (no copy),
+    for callers handling thousands of rows at once. Result records only (no --histogram).
+    Requires numpy.
+    """
+    import numpy as np
+
+    dtype = np.dtype([
+        ("length", "<u4"), ("version", "<u2"), ("kind", "<u2"), ("type", "S20"),
+        ("day_count", "<u4"), ("mean", "<f8"), ("stability", "<f8"), ("min_var", "<f8"),
+        ("max_var", "<f8"), ("std_dev", "<f8"), ("worst_case", "<f8"), ("worst_case_rieman", "<f8"),
+        ("worst_case_historical", "<f8"),
+    ])
+    if len(payload) % dtype.itemsize:
+        raise ValueError("payload is not a whole number of result records")
+    records = np.frombuffer(payload, dtype=dtype)
+    if (records["version"] != RESULT_SCHEMA_VERSION).any() or (records["length"] != dtype.itemsize - 4).any():
+        raise ValueError("unsupported result schema version or record length")
+    return records
+
+
+SHM_MAGIC = b"RISKSHM\0"
+SHM_SCHEMA_VERSION = 1
+SHM_HEADER = struct.Struct("=8s8I4Qq")
+SHM_SLOT = struct.Struct("=IiQ")
+SHM_HISTOGRAM = struct.Struct("=IIddQ")
+SHM_SAMPLES = struct.Struct("=II")
+# SEQLOCK RETRIES: a writer holds a block for one memcpy, so a handful of retries always suffices.
+SEQLOCK_RETRIES = 1000
+
+
+class SharedResults:
+    """
+    SHARED RESULTS READER
+    Maps the segment the engine daemon publishes (./finance_engine --daemon <csv>) read-only
+    and reads any asset's latest result, histogram or simulated samples straight out of it:
+    no subprocess, no pipe, the same answer in every Flask worker.
+
+    Each block is guarded by a seqlock (an odd counter means the daemon is mid-write): values
+    are unpacked from the mapping, then accepted only if the counter read the same even value
+    before and after. The daemon recreates the segment on restart, so the mapping is reopened
+    whenever the name points at a new inode.
+    """
+
+    def __init__(self, name="/risk_engine"):
+        self.path = "/dev/shm/" + name.lstrip("/")
+        self._map = None
+        self._inode = None
+        self._header = None
+
+    def _mapping(self):
+        # RE-MAP CHECK: one stat() per call; cheaper than any round trip to the engine.
+        try:
+            inode = os.stat(self.path).st_ino
+        except FileNotFoundError:
+            return None
+        if inode != self._inode:
+            if self._map is not None:
+                self._map.close()
+            self._map, self._inode, self._header = None, None, None
+            with open(self.path, "rb") as handle:
+                mapping = mmap.mmap(handle.fileno(), 0, access=mmap.ACCESS_READ)
+            if len(mapping) < SHM_HEADER.size:
+                mapping.close()
+                return None
+            header = SHM_HEADER.unpack_from(mapping, 0)
+            if header[0] != SHM_MAGIC or header[1] != SHM_SCHEMA_VERSION:
+                mapping.close()
+                return None
+            self._map, self._inode = mapping, inode
+            self._header = dict(zip(("magic", "version", "header_size", "slot_count", "slot_size",
+                                     "histogram_bins", "histogram_size", "sample_capacity", "sample_size",
+                                     "slots_offset", "histograms_offset", "samples_offset",
+                                     "generation", "started_ns"), header))
+        return self._map
+
+    def _stable(self, offset, read):
+        """Runs read() until it completes without the seqlock at 'offset' moving."""
+        for _ in range(SEQLOCK_RETRIES):
+            (before,) = struct.unpack_from("=I", self._map, offset)
+            if before & 1:
+                continue
+            value = read()
+            (after,) = struct.unpack_from("=I", self._map, offset)
+            if before == after:
+                return value
+        raise TimeoutError("shared result kept changing while being read")
+
+    def available(self):
+        """True while a daemon's segment is mapped and valid."""
+        return self._mapping() is not None
+
+    def generation(self):
+        """Number of complete publishes so far (0 before the first), or None without a daemon."""
+        mapping = self._mapping()
+        if mapping is None:
+            return None
+        return struct.unpack_from("=Q", mapping, SHM_HEADER.size - 16)[0]
+
+    def _find(self, asset):
+        if self._mapping() is None:
+            return None
+        header = self._header
+        for index in range(header["slot_count"]):
+            offset = header["slots_offset"] + index * header["slot_size"]
+
+            def read(offset=offset):
+                _, status, updated_ns = SHM_SLOT.unpack_from(self._map, offset)
+                return status, updated_ns, RESULT_STRUCT.unpack_from(self._map, offset + SHM_SLOT.size)
+
+            status, updated_ns, fields = self._stable(offset, read)
+            _, version, _, name, day_count, *values = fields
+            if version == RESULT_SCHEMA_VERSION and name.split(b"\0", 1)[0].decode("utf-8", "replace") == asset:
+                return index, status, updated_ns, ResultRecord(asset, day_count, *values)
+        return None
+
+    def result(self, asset):
+        """
+        Returns (status, updated_ns, ResultRecord) for the asset, or None if no daemon is
+        running or the dataset has no such asset. status follows the engine's exit codes
+        (0 published, 2 no variance).
+        """
+        found = self._find(asset)
+        return None if found is None else found[1:]
+
+    def histogram(self, asset):
+        """Returns (low, high, counts) of the asset's simulated returns, or None."""
+        found = self._find(asset)
+        if found is None:
+            return None
+        header = self._header
+        offset = header["histograms_offset"] + found[0] * header["histogram_size"]
+        counts_format = struct.Struct(f"={header['histogram_bins']}I")
+
+        def read():
+            _, bins, low, high, _ = SHM_HISTOGRAM.unpack_from(self._map, offset)
+            return low, high, list(counts_format.unpack_from(self._map, offset + SHM_HISTOGRAM.size))
+
+        return self._stable(offset, read)
+
+    def samples(self, asset):
+        """
+        Returns a copy of the asset's simulated returns (array of float32), or None when the
+        daemon runs without --shm-samples. The copy is what makes the seqlock check sound.
+        """
+        found = self._find(asset)
+        header = self._header
+        if found is None or not header["sample_capacity"]:
+            return None
+        offset = header["samples_offset"] + found[0] * header["sample_size"]
+
+        def read():
+            _, count = SHM_SAMPLES.unpack_from(self._map, offset)
+            values = array.array("f")
+            values.frombytes(self._map[offset + SHM_SAMPLES.size: offset + SHM_SAMPLES.size + 4 * count])
+            return values
+
+        return self._stable(offset, read)
+
+
+SNAPSHOT_MAGIC = b"RISKSNP\0"
+SNAPSHOT_VERSION = 2
+SNAPSHOT_HEADER = struct.Struct("=8sIIQQ")
+# ENTRY: name, bucket, day_count, capacity (spare room for --append), data_offset, then the
+# stored moments (count, mean, m2) and the EWMA variance.
+SNAPSHOT_ENTRY = struct.Struct("=20sIQQQqddd")
+
+# COLUMN UPLOADS: What the dashboard's CSV worker sends (ColumnHeader/ColumnBlock in finance_engine.c):
+# a header, then per block a NUL-padded name, a count and that many little-endian float32 returns.
+COLUMNS_MAGIC = b"RISKCOL\0"
+COLUMNS_VERSION = 1
+COLUMNS_HEADER = struct.Struct("<8sIIQ")
+
+
+def read_snapshot_assets(path):
+    """
+    SNAPSHOT INDEX
+    Lists the assets of an engine snapshot (./finance_engine <csv> --snapshot <path>) as
+    (name, day_count) pairs, reading only the header and entry table.
+    """
+    with open(path, "rb") as handle:
+        magic, version, count, _, _ = SNAPSHOT_HEADER.unpack(handle.read(SNAPSHOT_HEADER.size))
+        if magic != SNAPSHOT_MAGIC or version != SNAPSHOT_VERSION:
+            raise ValueError("not an engine snapshot of a supported version")
+        table = handle.read(SNAPSHOT_ENTRY.size * count)
+    return [(name.split(b"\0", 1)[0].decode("utf-8", "replace"), day_count)
+            for name, _, day_count, *_ in SNAPSHOT_ENTRY.iter_unpack(table)]
+
+
+def parse_timings(stderr):
+    """
+    TIMING REPORT
+    Returns the engine's --timings report (the {"event":"timings",...} JSON line on stderr)
+    as a dict, or None if the run did not emit one.
+    """
+    for line in reversed(stderr.splitlines()):
+        if line.startswith(b'{"event":"timings"'):
+            try:
+                return json.loads(line)
+            except ValueError:
+                return None
+    return None
+
+
+def parse_spans(stderr):
+    """
+    TRACE SPANS
+    Returns the spans an engine run with --trace wrote to stderr ({"event":"span",...}
+    lines), as dicts without the event tag.
+    """
+    spans = []
+    for line in stderr.splitlines():
+        if line.startswith(b'{"event":"span"'):
+            try:
+                span = json.loads(line)
+            except ValueError:
+                continue
+            del span["event"]
+            spans.append(span)
+    return spans
@@ -1,9 +1,42 @@
+//pthread_setaffinity_np, CPU_SET and fopencookie are GNU extensions.
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <math.h>
 #include <time.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <glob.h>
+#include <zlib.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+//SIMD kernel variants need GCC/Clang target pragmas and vector extensions on x86.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_X86 1
+#endif
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
 
 //The central repository for a specific investment type's performance and risk metrics.
 typedef struct {
@@ -21,6 +54,8 @@ typedef struct {
     float worst_case;
     //Analytical risk prediction derived from numerical integration (Riemann Sum).
     float worst_case_rieman;
+    //Exact 5% quantile of the history itself (--out-of-core only; NaN when not computed).
+    float worst_case_historical;
 } Portfolio;
 
 //Used during the CSV ingestion phase to map data from the file system to memory.
@@ -33,12 +68,561 @@ typedef struct{
 #define TABLE_SIZE 11
 //Buffer size for CSV line parsing.
 #define SIZE_LINE 256
+//Number of Monte Carlo samples drawn per run.
+#define SIM_SAMPLES 10000
+//Tail probability of the Value-at-Risk estimate (the 5th percentile).
+#define VAR_LEVEL 0.05
+//Uniform generator lanes; every instruction set steps the same 16 lanes, so all paths draw identical streams.
+#define RNG_LANES 16
+//Box-Muller consumes blocks of 32 uniforms: 16 radii followed by 16 angles.
+#define BOX_MULLER_BLOCK 32
+//Ranges this small finish in the scalar quickselect, where vector setup would not pay off.
+#define SELECT_SCALAR_CUTOFF 64
+//Bytes requested per fread() during ingestion.
+#define READ_BLOCK (1 << 20)
+//Samples generated per tile: uniforms, Box-Muller and histogram binning all run while the
+//tile is still in L1. A multiple of BOX_MULLER_BLOCK, so tiling never changes the samples.
+#define SIM_TILE 2048
+//Compressed bytes read per refill of the inflate stream.
+#define INFLATE_BLOCK (1 << 16)
+//Riemann steps evaluated per density-kernel call before the area check.
+#define RIEMANN_BLOCK 64
+//Slots in each worker's work-stealing deque; a push into a full deque runs the task inline.
+#define POOL_DEQUE_SIZE 1024
+//Upper bound on --threads, so a typo cannot spawn thousands of threads.
+#define POOL_MAX_THREADS 256
+//Elements per parallel_reduce chunk. Fixed (not derived from the worker count) so
+//sums come out bit-identical whatever --threads is.
+#define REDUCE_GRAIN 65536
+//Samples per independently seeded simulation chunk; smaller runs stay on one stream.
+#define SIM_CHUNK 65536
+//Slots in each pipeline ring (raw blocks reader->parser, row batches parser->accumulator).
+#define PIPELINE_RING_SLOTS 4
+//Streaming mode: bytes per read() of the feed, and the open-addressed symbol table size (power of two).
+#define STREAM_READ_BLOCK 65536
+#define STREAM_MAX_ASSETS 4096
+//Quantile sketch geometry: relative accuracy, bins per sign, and the magnitude below which a return counts as zero.
+#define SKETCH_ALPHA 0.01
+#define SKETCH_BINS 1024
+#define SKETCH_MIN_VALUE 1e-6
+//Out-of-core mode: values of one asset kept per filter pass, and the bins a bracket is split
+//into when more than that fall inside it.
+#define OOC_CANDIDATES (1 << 20)
+#define OOC_REFINE_BINS 4096
+//RiskMetrics decay for the streamed EWMA variance (--ewma-lambda overrides it).
+#define EWMA_LAMBDA 0.94
+//Standard normal quantile at VAR_LEVEL (0.05).
+#define Z_VAR_LEVEL -1.6448536269514722
+//Layout version of ResultRecord; bump it on any change to the record.
+#define RESULT_SCHEMA_VERSION 2
+//Record kinds sharing the result framing: an asset's figures, and its simulated-return histogram.
+#define RECORD_KIND_RESULT 0
+#define RECORD_KIND_HISTOGRAM 1
+//Shared-memory publication (--daemon): default segment, layout version, histogram resolution, file poll period.
+#define SHM_DEFAULT_NAME "/risk_engine"
+#define SHM_SCHEMA_VERSION 1
+#define SHM_HISTOGRAM_BINS 64
+#define DAEMON_REFRESH_MS 200
+//Binary dataset snapshots (--snapshot): magic, layout version, and the alignment of every bucket's array.
+#define SNAPSHOT_MAGIC "RISKSNP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ALIGN 64
+//Spare slots reserved after each snapshot array for --append: a 1/SNAPSHOT_SPARE_DIVISOR
+//share of its length, and never fewer than SNAPSHOT_SPARE_MIN (most of a year of nightly rows).
+#define SNAPSHOT_SPARE_MIN 256
+#define SNAPSHOT_SPARE_DIVISOR 16
+//Client-side pre-parsed uploads (column blocks of float32 returns): magic and layout version.
+#define COLUMNS_MAGIC "RISKCOL"
+#define COLUMNS_VERSION 1
+
+//xoshiro128+ state for RNG_LANES independent lanes, stored lane-contiguous for vector loads.
+typedef struct {
+    uint32_t s[4][RNG_LANES] __attribute__((aligned(64)));
+    //The seed and the number of child streams handed out, for parallel simulation.
+    unsigned long long seed;
+    unsigned long long streams;
+} EngineRng;
+
+//Instruction-set tiers the hot kernels are compiled for, lowest first.
+typedef enum {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_AVX512,
+    SIMD_TIER_COUNT
+} SimdTier;
+
+//Function pointers for every hot kernel, bound once at startup by kernels_init().
+typedef struct {
+    const char *name;
+    //Parse: sets bit i of word i/64 for every ',' (commas) and '\n' (newlines) byte.
+    void (*scan_delimiters)(const char* buffer, size_t length, uint64_t* commas, uint64_t* newlines);
+    //Moments: double-accumulated sum, and sum of squared deviations from 'mean'.
+    double (*sum)(const float* data, int count);
+    double (*sum_sq_dev)(const float* data, int count, float mean);
+    //RNG: fills 'count' (a multiple of RNG_LANES) uniforms in (0, 1].
+    void (*uniforms)(EngineRng* rng, float* out, int count);
+    //Normal transform: Box-Muller over whole BOX_MULLER_BLOCKs; may run in place.
+    void (*box_muller)(const float* uniforms, float* out, int count, float mean, float deviation);
+    //Select: returns the k-th smallest value (0-based); data is left a permutation of its input.
+    float (*select)(float* data, int count, int k);
+    //Integration: normal density of each x, as the Riemann scan evaluates it.
+    void (*gaussian_density)(const float* x, float* out, int count, float mean, float deviation);
+    //Elementwise math over arrays; the scalar tier is libm, the others simd_math.h.
+    void (*log_array)(const float* in, float* out, int count);
+    void (*exp_array)(const float* in, float* out, int count);
+    void (*sincos_array)(const float* in, float* sin_out, float* cos_out, int count);
+    void (*sqrt_array)(const float* in, float* out, int count);
+} EngineKernels;
+//Body of a parallel loop: processes the half-open index range [begin, end).
+typedef void (*RangeBody)(void* arg, long begin, long end);
+
+//Completion counter shared by every task of one parallel_for.
+typedef struct {
+    atomic_long pending;
+} TaskGroup;
+
+//A range of a parallel loop; split in half on execution until it is at most 'grain' long.
+typedef struct {
+    RangeBody body;
+    void *arg;
+    long begin;
+    long end;
+    long grain;
+    TaskGroup *group;
+} PoolTask;
+
+//Chase-Lev deque: the owner pushes and takes at the bottom, thieves steal from the top.
+typedef struct {
+    atomic_long top __attribute__((aligned(64)));
+    atomic_long bottom __attribute__((aligned(64)));
+    _Atomic(PoolTask*) slots[POOL_DEQUE_SIZE];
+} WorkDeque;
+
+//The engine-wide worker pool. Threads start on the first parallel loop that can use them.
+typedef struct {
+    //Participating threads including the caller (--threads); workers = threads - 1.
+    int threads;
+    //--pin: bind each worker to its own allowed CPU.
+    int pin;
+    int started;
+    pthread_t *workers;
+    WorkDeque *deques;
+    //Tasks submitted by threads outside the pool (main, daemon request threads).
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    PoolTask **injected;
+    int injected_head;
+    int injected_count;
+    int injected_capacity;
+    //Tasks sitting in any deque or the injection queue, and workers asleep waiting for one.
+    atomic_long queued;
+    atomic_int sleepers;
+    atomic_int shutdown;
+} ThreadPool;
+
+//Count, mean and sum of squared deviations of a sample; two of these merge exactly (Chan et al.).
+typedef struct {
+    long count;
+    double mean;
+    double m2;
+} Moments;
+
+//Lock-free single-producer/single-consumer ring over preallocated slots, used in place:
+//the producer claims and publishes the head slot, the consumer peeks and releases the tail.
+typedef struct {
+    atomic_size_t head __attribute__((aligned(64)));
+    atomic_size_t tail __attribute__((aligned(64)));
+    void *slots[PIPELINE_RING_SLOTS];
+} SpscRing;
+
+//A run of whole CSV lines handed from the reader to a parser; 'end' marks the end of input.
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int end;
+} PipelineBlock;
+
+//The rows of one block that belong to one accumulator, as (bucket index, value) pairs,
+//plus the name each bucket index was first seen under in this block.
+typedef struct {
+    unsigned char *ids;
+    float *values;
+    size_t count;
+    size_t capacity;
+    unsigned present;
+    char names[TABLE_SIZE][20];
+    int end;
+} PipelineBatch;
+
+//Throughput counters of one pipeline thread; stall is time spent waiting on a ring.
+typedef struct {
+    const char *stage;
+    int id;
+    long long busy_ns;
+    long long stall_ns;
+    long blocks;
+    long rows;
+    size_t bytes;
+} StageCounters;
+
+//Log-bucketed quantile sketch (DDSketch): every quantile it returns is within SKETCH_ALPHA
+//relative error of a true sample value. Counts are per bin, so two sketches merge by addition.
+typedef struct {
+    uint64_t positive[SKETCH_BINS];
+    uint64_t negative[SKETCH_BINS];
+    uint64_t zero;
+    uint64_t count;
+} QuantileSketch;
+
+//Risk state of one streamed symbol, updated in O(1) per event.
+typedef struct {
+    char name[20];
+    Moments moments;
+    double ewma_var;
+    //Previous price (--prices) and the timestamp of the latest event.
+    double last_price;
+    long long last_ts;
+    //Set by an update, cleared when the asset is published.
+    int dirty;
+    QuantileSketch sketch;
+} StreamAsset;
+
+//One asset of an out-of-core run (--out-of-core): everything known about it while the input
+//streams past, bounded regardless of how many rows it has.
+typedef struct {
+    char type_name[20];
+    int present;
+    //Exact moments: a chunk's Welford accumulator is merged into the total after each block.
+    Moments moments;
+    Moments chunk;
+    //First pass: brackets the VaR order statistic to one sketch bin.
+    QuantileSketch sketch;
+    //The order statistic sought (0-based, picked as analyze() picks it) and, once found, its value.
+    long rank;
+    int resolved;
+    float quantile;
+    //Current bracket as an inclusive range of ooc_key() values, the shift that maps it onto
+    //OOC_REFINE_BINS, and what the last filter pass saw against it.
+    uint32_t low;
+    uint32_t high;
+    int shift;
+    long below;
+    long inside;
+    uint32_t inside_min;
+    uint32_t inside_max;
+    //The values inside the bracket while they fit 'capacity', and a histogram of the
+    //bracket to narrow it when they do not.
+    float *candidates;
+    long capacity;
+    uint64_t refine[OOC_REFINE_BINS];
+} OutOfCoreAsset;
+
+//Binary feed record (--binary): 40 bytes, little-endian, no padding.
+typedef struct {
+    //NUL-terminated unless all 20 bytes are used.
+    char symbol[20];
+    uint32_t reserved;
+    double value;
+    int64_t timestamp_ns;
+} StreamTick;
+
+//One analysed asset as written to stdout: fixed layout, little-endian, no padding (96 bytes).
+//'length' counts the bytes after itself, so a reader can frame a run of records and skip
+//versions it does not know. Percentages are the same values the legacy CSV prints with %.4f.
+typedef struct {
+    uint32_t length;
+    uint16_t version;
+    //RECORD_KIND_RESULT; other kinds (HistogramRecord) share the first 8 bytes.
+    uint16_t kind;
+    char type_name[20];
+    uint32_t day_count;
+    double mean;
+    double stability;
+    double min_var;
+    double max_var;
+    double std_dev;
+    double worst_case;
+    double worst_case_rieman;
+    //NaN unless the run computed the historical quantile (--out-of-core).
+    double worst_case_historical;
+} ResultRecord;
+
+//Histogram of an asset's simulated returns (--histogram), written right after its
+//ResultRecord: SHM_HISTOGRAM_BINS equal bins over [low, high), outliers in the edge bins.
+//312 bytes instead of the SIM_SAMPLES floats themselves.
+typedef struct {
+    uint32_t length;
+    uint16_t version;
+    uint16_t kind;
+    char type_name[20];
+    uint32_t bins;
+    double low;
+    double high;
+    uint32_t total;
+    uint32_t reserved;
+    uint32_t counts[SHM_HISTOGRAM_BINS];
+} HistogramRecord;
+_Static_assert(sizeof(HistogramRecord) == 312, "HistogramRecord layout is part of the protocol");
+_Static_assert(sizeof(ResultRecord) == 96, "ResultRecord must stay unpadded");
+
+//Start of the shared results segment (128 bytes). Offsets are from the segment start, and
+//every block after the header is in host byte order except the embedded ResultRecords.
+typedef struct {
+    //"RISKSHM", written last so a reader never trusts a half-built segment.
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint32_t histogram_bins;
+    uint32_t histogram_size;
+    //0 when the daemon runs without --shm-samples.
+    uint32_t sample_capacity;
+    uint32_t sample_size;
+    uint64_t slots_offset;
+    uint64_t histograms_offset;
+    uint64_t samples_offset;
+    //Bumped after every complete publish, so readers can tell when anything changed.
+    _Atomic uint64_t generation;
+    int64_t started_ns;
+    char pad[48];
+} ShmHeader;
+_Static_assert(sizeof(ShmHeader) == 128, "ShmHeader layout is part of the protocol");
+
+//The latest result of one bucket (slot i = bucket i). 'seq' is a seqlock: odd while the
+//daemon writes, and a reader's copy is valid only if it saw the same even value before and after.
+typedef struct {
+    _Atomic uint32_t seq;
+    //Engine exit-code meaning: 0 published, 2 no variance, 3 no such asset in the dataset.
+    int32_t status;
+    int64_t updated_ns;
+    ResultRecord record;
+    char pad[16];
+} ShmSlot;
+_Static_assert(sizeof(ShmSlot) == 128, "ShmSlot layout is part of the protocol");
+
+//Histogram of one bucket's simulated returns over [low, high); outliers land in the edge bins.
+typedef struct {
+    _Atomic uint32_t seq;
+    uint32_t bins;
+    double low;
+    double high;
+    uint64_t total;
+    uint32_t counts[SHM_HISTOGRAM_BINS];
+} ShmHistogram;
+
+//The simulated returns themselves (--shm-samples), in generation order: copied before the tail select.
+typedef struct {
+    _Atomic uint32_t seq;
+    uint32_t count;
+    float values[SIM_SAMPLES];
+} ShmSamples;
+
+//Start of a snapshot file (32 bytes). Snapshots are a local cache of parsed datasets, so
+//they are in host byte order; SnapshotEntry records for every bucket follow the header.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t bucket_count;
+    uint64_t rows;
+    uint64_t reserved;
+} SnapshotHeader;
+_Static_assert(sizeof(SnapshotHeader) == 32, "SnapshotHeader layout is part of the format");
+
+//One bucket of a snapshot: its name, its hash slot, where its returns are and their moments
+//(so a loaded dataset skips the mean and deviation passes, as the pipeline does). Each array
+//has room for 'capacity' returns, so --append extends it in place; ewma_var is the RiskMetrics
+//variance after the last return, carried forward by each append.
+typedef struct {
+    char type_name[20];
+    uint32_t bucket;
+    uint64_t day_count;
+    uint64_t capacity;
+    uint64_t data_offset;
+    int64_t moments_count;
+    double mean;
+    double m2;
+    double ewma_var;
+} SnapshotEntry;
+_Static_assert(sizeof(SnapshotEntry) == 80, "SnapshotEntry layout is part of the format");
+
+//Start of a column upload (24 bytes), written by the dashboard's CSV worker: the browser
+//parses the text, so the upload is the numbers themselves. Little-endian, like every field
+//a client produces; 'blocks' ColumnBlock records follow, each directly followed by its values.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t blocks;
+    uint64_t rows;
+} ColumnHeader;
+_Static_assert(sizeof(ColumnHeader) == 24, "ColumnHeader layout is part of the format");
+
+//One symbol's run of returns: NUL-padded name and the number of float32 values that follow.
+//A symbol may appear in several blocks; they are appended in order, as CSV rows are.
+typedef struct {
+    char type_name[20];
+    uint32_t count;
+} ColumnBlock;
+_Static_assert(sizeof(ColumnBlock) == 24, "ColumnBlock layout is part of the format");
+
+//One input of a multi-file ingestion: the file's own symbol table, filled by a pool thread
+//and merged into the global buckets afterwards, with the moments of each of its buckets.
+typedef struct {
+    const char *path;
+    Portfolio *buckets[TABLE_SIZE];
+    Moments moments[TABLE_SIZE];
+    long rows;
+    int status;
+} InputTable;
+
+//Counters of a streaming session, reported with --timings.
+typedef struct {
+    long events;
+    long rejected;
+    int assets;
+    long publishes;
+    long long start_ns;
+    //Time spent applying events, and the longest a read batch took from read() to applied.
+    long long busy_ns;
+    long long max_batch_ns;
+    long long max_publish_ns;
+} StreamStats;
+
 //Constants utilized for Gaussian distribution and Box-Muller transformations.
 #define PI 3.1415927
 #define INV_SQRT_2PI (1.0f / sqrtf(PI * 2.0f))
 //Global Hash Table for Portfolio Storage
 Portfolio *buckets[TABLE_SIZE];
 
+//Identifiers for every instrumented phase (and sub-step) of main(), in pipeline order.
+typedef enum {
+    PHASE_VALIDATION,
+    PHASE_INGESTION,
+    PHASE_RETRIEVAL,
+    PHASE_STATISTICS,
+    STEP_MEAN,
+    STEP_STAND_DEV,
+    PHASE_MODELING,
+    STEP_SIMULATION,
+    STEP_SORT,
+    STEP_RIEMANN,
+    PHASE_OUTPUT,
+    PHASE_COUNT
+} PhaseId;
+
+//Start stamp and accumulated duration of one phase, on both the monotonic clock and the TSC.
+typedef struct {
+    const char *name;
+    long long start_ns;
+    //Monotonic stamp of the first phase_begin, the start of the phase's trace span.
+    long long first_start_ns;
+    long long elapsed_ns;
+    unsigned long long start_tsc;
+    unsigned long long elapsed_tsc;
+    int ran;
+} PhaseTimer;
+
+//Optional switches accepted after the two positional arguments.
+typedef struct {
+    //--timings: emit a JSON line of per-phase timings on stderr.
+    int timings;
+    //--perf-counters: emit a JSON line of per-phase hardware counters on stderr.
+    int perf_counters;
+    //--threads N: threads sharing parallel work (0 = ENGINE_THREADS, else every online CPU).
+    int threads;
+    //--pin: pin pool workers to CPUs (ENGINE_PIN=1 does the same).
+    int pin;
+    //--pipeline: overlap reading, parsing and accumulation on dedicated stage threads.
+    int pipeline;
+    //--stream: read a live feed of (symbol, value, timestamp) events instead of a CSV file.
+    int stream;
+    //--binary: the feed is StreamTick records rather than text lines.
+    int binary;
+    //--prices: feed values are prices; returns are taken between consecutive ticks.
+    int prices;
+    //--publish-ms / --publish-every: publish cadence in milliseconds and in events (0 = off).
+    int publish_ms;
+    long publish_every;
+    //--ewma-lambda: decay of the EWMA variance.
+    double ewma_lambda;
+    //--csv: print the legacy text line instead of a binary ResultRecord.
+    int csv;
+    //--daemon: keep analysing the dataset and publish every asset to shared memory.
+    int daemon;
+    //--shm NAME / --shm-samples / --refresh-ms N: segment name, sample blocks, file poll period.
+    const char *shm_name;
+    int shm_samples;
+    int refresh_ms;
+    //--snapshot PATH: write the parsed dataset to PATH instead of analysing an asset.
+    const char *snapshot_path;
+    //--append DELTA: add the rows of the DELTA CSV to the snapshot named by the positional argument.
+    const char *append_path;
+    //--trace ID (or ENGINE_TRACE_ID): emit one JSON span per phase on stderr, tagged with ID.
+    const char *trace_id;
+    //--all: analyse every asset in the dataset and write one record per asset.
+    int all;
+    //--histogram: follow each result with a HistogramRecord of its simulated returns.
+    int histogram;
+    //--assets A,B,...: batch mode restricted to the listed asset types (NULL analyses every asset).
+    const char *assets;
+    //--out-of-core: stream the CSV in passes instead of loading it; records carry the exact historical quantile.
+    int out_of_core;
+    //Dataset files: every positional argument before the asset type, patterns expanded by glob(3).
+    char **inputs;
+    int input_count;
+} EngineOptions;
+
+//Hardware events sampled as one perf group; cycles leads so all members are scheduled together.
+typedef enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_EVENT_COUNT
+} PerfEventId;
+
+//One perf_event_open group plus the per-phase counter snapshots taken by phase_begin/phase_end.
+typedef struct {
+    //Group leader descriptor, -1 when the kernel refused the group.
+    int leader_fd;
+    //Per-event descriptor, -1 for members the PMU (or a VM) does not expose.
+    int fds[PERF_EVENT_COUNT];
+    //Position of each opened event inside the PERF_FORMAT_GROUP read buffer.
+    int slot[PERF_EVENT_COUNT];
+    int opened;
+    //Reason the group is unavailable, reported instead of counters.
+    const char *error;
+    unsigned long long start[PHASE_COUNT][PERF_EVENT_COUNT];
+    unsigned long long total[PHASE_COUNT][PERF_EVENT_COUNT];
+} PerfGroup;
+
+EngineOptions options = {
+    .publish_ms = 1000, .ewma_lambda = EWMA_LAMBDA, .shm_name = SHM_DEFAULT_NAME, .refresh_ms = DAEMON_REFRESH_MS
+};
+//Sub-steps use dotted names so the report can be grouped by parent phase.
+PhaseTimer phase_timers[PHASE_COUNT] = {
+    {"validation"}, {"ingestion"}, {"retrieval"}, {"statistics"},
+    {"statistics.mean"}, {"statistics.stand_dev"}, {"modeling"},
+    {"modeling.simulation"}, {"modeling.sort"}, {"modeling.riemann"}, {"output"}
+};
+PerfGroup perf_group = { .leader_fd = -1 };
+//Throughput denominators for the timing report.
+long rows_ingested = 0;
+int samples_generated = 0;
+//Per-bucket moments computed during pipelined ingestion (count 0 when not used).
+Moments ingest_moments[TABLE_SIZE];
+//Stage counters of the last pipelined ingestion: reader, parsers, then accumulators.
+StageCounters *pipeline_stages;
+int pipeline_stage_count;
+//Streaming symbol table (slots by name hash) and its assets in order of first appearance.
+StreamAsset *stream_assets[STREAM_MAX_ASSETS];
+StreamAsset *stream_order[STREAM_MAX_ASSETS];
+StreamStats stream_stats;
+//Out-of-core assets by bucket index.
+OutOfCoreAsset ooc_assets[TABLE_SIZE];
+
 // Maps a string identifier to a specific index in the global buckets array.
 // Uses a basic hashing algorithm to ensure uniform distribution.
 int hash(char* type);
@@ -51,12 +635,103 @@ Portfolio* create_bucket(char *type);
 
 //Parses a single string from a CSV source, converting raw text
 //into a structured RawData format for processing.
-void load(char* line, RawData* data);
+int load(char* line, RawData* data);
+
+//Splits one line (already delimited by the caller) into type and value.
+int parse_line(const char* line, const char* comma, const char* end, RawData* data);
+
+//Converts the numeric text of a return with the same result as atof(), without the locale machinery.
+float parse_return(const char* text, const char* end);
+
+//The double-precision parser behind parse_return(); streamed prices need the extra digits.
+double parse_decimal(const char* text, const char* end);
+
+//Routes a parsed entry to its bucket, growing the bucket's array as needed.
+int store_entry(RawData* entry);
+
+//Reads a whole CSV stream block by block, storing every well-formed row.
+int ingest_stream(FILE* input);
+
+//Loads a dataset from whichever the file holds: a snapshot, a column upload, or CSV text
+//(pipelined with --pipeline), the text optionally gzip/zlib-compressed.
+int ingest_file(FILE* input);
+
+//Loads several CSV files (each optionally compressed) concurrently, one symbol table per file,
+//then concatenates every symbol's returns in file order; 0 on success, 1 on any failure.
+int ingest_inputs(char** paths, int count);
+
+//Writes every bucket (returns and moments) to a snapshot file; 0 on success, 1 on I/O failure.
+int snapshot_write(const char* path);
+
+//Appends a delta CSV to a snapshot in place (spare capacity first, relocating only arrays
+//that outgrow theirs) and updates its moments and EWMA state; 0 on success, 1 on failure.
+int snapshot_append(const char* path, const char* delta_path);
+
+//Folds returns into a RiskMetrics variance; 'seen' is how many returns it already covers.
+double ewma_fold(double ewma_var, long seen, const float* values, long count);
+
+//Fills the buckets and ingest_moments from a snapshot; 0 on success, 1 if it is malformed.
+int snapshot_load(FILE* input);
+
+//Fills the buckets from a column upload; 0 on success, 1 if it is malformed or memory runs out.
+int columns_load(FILE* input);
+
+//Wraps a gzip/zlib-compressed stream as a read-only FILE* of its decompressed bytes
+//(NULL on allocation failure); closing it frees the inflater but leaves 'compressed' open.
+FILE* inflate_open(FILE* compressed);
+
+//Same result as ingest_stream(), with reader, parser and accumulator stages running
+//concurrently; fills ingest_moments for every bucket as the rows arrive.
+int ingest_pipeline(FILE* input);
+
+//Folds a sample's moments into a running total.
+void moments_merge(Moments* into, long count, double mean, double m2);
+
+//Writes the pipeline's per-stage counters as one JSON line on stderr.
+void report_pipeline(void);
+
+//Adds one return to a sketch; returns the value at quantile q (0..1) of everything added.
+void sketch_add(QuantileSketch* sketch, double value);
+double sketch_quantile(const QuantileSketch* sketch, double q);
+
+//Applies one event to its symbol's moments, EWMA variance and sketch.
+int stream_event(const char* symbol, size_t length, double value, long long timestamp);
+
+//Writes every asset updated since the last publish as one JSON line on stdout.
+void stream_publish(void);
+
+//Runs the streaming mode on a source ("-" for stdin, "tcp:PORT" to listen on loopback) until EOF or a signal.
+int stream_run(const char* source);
+
+//Writes the streaming session's counters as one JSON line on stderr.
+void report_stream(void);
+
+//Frees every bucket and the pipeline's moments so a dataset can be loaded again.
+void reset_buckets(void);
+
+//Analyses every bucket of the dataset and publishes it to the shared segment, again whenever
+//the file changes, until SIGINT/SIGTERM; the segment is removed on the way out.
+int daemon_run(const char* csv_path);
+
+//Out-of-core analysis of the queried asset (or, with --all/--assets, of each selected asset):
+//exact moments and exact historical VaR from a few streamed passes over the CSV, in memory
+//bounded by OOC_CANDIDATES per asset instead of by the file. Same exit codes as main().
+int out_of_core_run(FILE* input, char* user_query);
 
 
 //Implements the Box-Muller transform to generate a normally distributed
-//synthetic dataset (10,000 samples) based on provided parameters.
-float* synth_data_generator(float mean, float deviation);
+//synthetic dataset ('count' samples, SIM_SAMPLES in production) based on provided parameters.
+float* synth_data_generator(float mean, float deviation, int count);
+
+//Same samples as synth_data_generator(), binned into 'histogram' (mean +/- 4 deviations) as
+//each tile is generated; a NULL histogram skips the binning.
+float* synth_data_binned(float mean, float deviation, int count, ShmHistogram* histogram);
+
+//Empties a histogram and sets its range to mean +/- 4 deviations.
+void histogram_reset(ShmHistogram* histogram, double mean, double deviation);
+
+//Adds samples to a histogram's counts (and total).
+void histogram_add(ShmHistogram* histogram, const float* samples, int count);
 
 //Calculates the arithmetic mean of a float array.
 float mean(float* data, int count);
@@ -64,177 +739,743 @@ float mean(float* data, int count);
 //Computes the standard deviation of a dataset to measure volatility.
 float stand_dev(float* data, int count, float mean);
 
-//Sorts data and performs a historical simulation to identify the 5th percentile loss.
+//Selects the 5th percentile loss of a simulated (or historical) sample.
+//compare() is the qsort ordering the selection replaced, kept as the benchmark baseline.
 int compare(const void *a, const void *b);
-void analyze(float* data, Portfolio* bucket);
+void analyze(float* data, int count, Portfolio* bucket);
 
 //Calculates the 5% Value at Risk by scanning the Probability Density Function.
 //using a Riemann sum approach to find the cumulative density threshold.
 void rieman(float* data, float mean, float deviation, Portfolio* address);
 
 
+//Mean, deviation, simulation and both VaR estimates for one bucket (Phases 4 and 5 of main()),
+//binning the simulated returns into 'histogram' and copying them to 'generated' when not NULL.
+int analyze_bucket(int index, float** simulated, ShmHistogram* histogram, float* generated);
+
 //Formats the analytical results and pipes them to stdout for integration with the Python dashboard.
 int send2python(Portfolio* ptr, char* user_query);
 
+//Stability score and VaR bounds in percent, as the dashboard shows them.
+void risk_scores(Portfolio* ptr, float* stability, float* min_percentage, float* max_percentage);
+
+//Analyses every non-empty bucket, or those --assets names, and writes one result per asset (--all).
+int analyze_all(void);
+
+//1 if --assets is unset or lists an asset type that hashes to 'index'.
+int asset_selected(int index);
+
+//Fills the binary result record of an analysed bucket (little-endian on every host).
+void encode_result(Portfolio* ptr, ResultRecord* record);
+
+//Writes the HistogramRecord of an analysed bucket to stdout; 0 on success, 1 on write failure.
+int send_histogram(Portfolio* ptr, const ShmHistogram* histogram);
+
+//Splits argv into the two positional arguments and the optional --switches.
+int parse_options(int argc, char* argv[], char** csv_path, char** user_query);
+
+//Stamp the start and end of a phase; no-ops unless --timings, --perf-counters or --trace is set.
+void phase_begin(PhaseId id);
+void phase_end(PhaseId id);
+
+//Writes the collected phase timings as one JSON line on stderr.
+void report_timings(int exit_code);
+
+//Writes one JSON span line per phase that ran, tagged with the trace ID, on stderr.
+void report_spans(int exit_code);
+
+//Opens the grouped hardware counters; failure leaves perf_group.error set instead of aborting.
+void perf_open(void);
+
+//Reads the current (multiplex-scaled) value of every opened counter.
+void perf_read(unsigned long long values[PERF_EVENT_COUNT]);
+
+//Writes the per-phase hardware counters as one JSON line on stderr.
+void report_perf_counters(int exit_code);
+
+//Single exit point for main() so every outcome (including errors) is reported.
+int engine_exit(int exit_code);
+
+//Portable kernels; also the reference every SIMD variant is checked against.
+void scan_delimiters_scalar(const char* buffer, size_t length, uint64_t* commas, uint64_t* newlines);
+double sum_scalar(const float* data, int count);
+double sum_sq_dev_scalar(const float* data, int count, float mean);
+void uniforms_scalar(EngineRng* rng, float* out, int count);
+void box_muller_scalar(const float* uniforms, float* out, int count, float mean, float deviation);
+float select_scalar(float* data, int count, int k);
+void gaussian_density_scalar(const float* x, float* out, int count, float mean, float deviation);
+void log_array_scalar(const float* in, float* out, int count);
+void exp_array_scalar(const float* in, float* out, int count);
+void sincos_array_scalar(const float* in, float* sin_out, float* cos_out, int count);
+void sqrt_array_scalar(const float* in, float* out, int count);
+
+//Seeds every RNG lane from one 64-bit seed.
+void rng_seed(EngineRng* rng, unsigned long long seed);
 
+//Returns the kernel table of a tier, or NULL if it was not compiled in or the CPU lacks it.
+const EngineKernels* kernels_for_tier(SimdTier tier);
 
+//Detects CPU features and binds 'kernels' to the best tier (capped by ENGINE_SIMD).
+void kernels_init(void);
+
+//Seeds 'child' with an independent stream derived from the parent's seed.
+void rng_split(EngineRng* parent, EngineRng* child, unsigned long long stream);
+
+//Sets the pool size and pinning; threads are only created when a parallel loop needs them.
+void pool_configure(int threads, int pin);
+
+//Runs body over [0, count) on the pool, splitting ranges down to 'grain' indices.
+//Safe to call from any thread, including from inside another parallel loop.
+void parallel_for(long count, long grain, RangeBody body, void* arg);
+
+//Sums body's partial results over fixed 'grain'-sized chunks of [0, count), in chunk order.
+double parallel_reduce(long count, long grain, double (*body)(void* arg, long begin, long end), void* arg);
+
+//Stops and joins the workers (a no-op if they never started).
+void pool_shutdown(void);
+
+//The bound kernel table; starts on the scalar tier so tools work without kernels_init().
+EngineKernels kernels = {
+    "scalar", scan_delimiters_scalar, sum_scalar, sum_sq_dev_scalar,
+    uniforms_scalar, box_muller_scalar, select_scalar, gaussian_density_scalar,
+    log_array_scalar, exp_array_scalar, sincos_array_scalar, sqrt_array_scalar
+};
+//Shared generator for the Monte Carlo simulation.
+EngineRng engine_rng;
+//The single pool every phase (and every concurrent request) schedules onto.
+ThreadPool pool = {
+    .threads = 1, .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER
+};
+
+
+
+//Companion tools (bench_engine.c) #include this file for its kernels and define
+//FINANCE_ENGINE_NO_MAIN to supply their own entry point.
+#ifndef FINANCE_ENGINE_NO_MAIN
 /**
  * Main Execution Loop
  * Handles file I/O, memory management, and orchestration of the analysis pipeline.
- * * Usage: ./risk_engine <csv_file> <investment_type>
+ * * Build: gcc -O2 -pthread finance_engine.c -o finance_engine -lm -lz
+ * * Usage: ./risk_engine <csv_file> <investment_type> [--csv] [--timings] [--perf-counters] [--trace ID] [--threads N] [--pin] [--pipeline]
+ * *        ./risk_engine --stream <-|tcp:PORT> [--binary] [--prices] [--publish-ms N] [--publish-every N] [--ewma-lambda L]
+ * *        ./risk_engine --daemon <csv_file> [--shm NAME] [--shm-samples] [--refresh-ms N]
+ * *        ./risk_engine <csv_file> --snapshot <snapshot_file>   (a snapshot is accepted anywhere a CSV is)
+ * *        ./risk_engine <snapshot_file> --append <delta_csv>   (adds the delta's rows to the snapshot in place)
+ * *        ./risk_engine <csv_file> --all   (one result per asset)
+ * *        ./risk_engine <csv_file> [<csv_file> ...] <Asset_Type>   (files or quoted globs, concatenated per asset in order)
+ * *        ./risk_engine [switches] -- <csv_file> <Asset_Type>   (nothing after "--" is read as a switch)
+ * *        ./risk_engine <csv_file> --assets EQUITY,BOND,...   (one result per listed asset)
+ * *        --out-of-core streams the CSV in passes instead of loading it (records also carry the exact historical 5% quantile)
+ * *        --histogram follows each binary result with a HistogramRecord of its simulated returns
+ * * Environment: ENGINE_SIMD=scalar|sse2|avx2|avx512 caps the kernel tier (for testing each path);
+ * ENGINE_THREADS and ENGINE_PIN=1 stand in for --threads and --pin, ENGINE_TRACE_ID for --trace.
  */
 int main(int argc, char* argv[]){
     //Variable Initialization
-    float *temp_data = malloc(sizeof(float) * 10000);
-    FILE *input_data;
-    RawData current_entry;
-    char buffer[SIZE_LINE];
-    Portfolio *type_bucket;
-    float average;
-    float sdev;
+    float *temp_data;
+    FILE *input_data = NULL;
+    char *csv_path;
+    char *user_query;
     int index;
-    Portfolio *ptr;
     int test;
+    ShmHistogram histogram;
 
     // Phase 1: Argument and File Validation
-    if (argc != 3){
+    if (parse_options(argc, argv, &csv_path, &user_query) != 0){
         return 1; // Incorrect usage
     }
-    if ((input_data = fopen(argv[1], "r")) == NULL){
-        return 1; // File access error
+    kernels_init();
+    pool_configure(options.threads, options.pin);
+    if (options.perf_counters){
+        perf_open();
+    }
+    //A live feed or the resident daemon replaces the whole batch pipeline below.
+    if (options.stream){
+        return engine_exit(stream_run(csv_path));
+    }
+    if (options.daemon){
+        return engine_exit(daemon_run(csv_path));
+    }
+    //A nightly delta extends an existing snapshot instead of rebuilding it.
+    if (options.append_path != NULL){
+        return engine_exit(snapshot_append(csv_path, options.append_path));
+    }
+    phase_begin(PHASE_VALIDATION);
+    //Several inputs are opened by the threads that ingest them.
+    if (options.input_count == 1 && (input_data = fopen(csv_path, "r")) == NULL){
+        return engine_exit(1); // File access error
+    }
+    rng_seed(&engine_rng, time(NULL));
+    phase_end(PHASE_VALIDATION);
+    //Datasets larger than memory are streamed past in passes instead of loaded.
+    if (options.out_of_core){
+        return engine_exit(out_of_core_run(input_data, user_query));
     }
-    srand(time(NULL));
     // Phase 2: Data Ingestion and Dynamic Memory Scaling
-    while (fgets(buffer, SIZE_LINE, input_data) != NULL) {
-        load(buffer, &current_entry);
-        index = hash(current_entry.type);
-        //Initialization of hash table buckets
-        if (buckets[index] == NULL) {
-            buckets[index] = create_bucket(current_entry.type);
-            if (buckets[index] == NULL) return 1;
+    phase_begin(PHASE_INGESTION);
+    if (options.input_count > 1){
+        if (ingest_inputs(options.inputs, options.input_count) != 0){
+            return engine_exit(1);
         }
-
-        // Dynamic Array Resizing to avoid memory leak or segmentation fault.
-        if (buckets[index]->day_count >= buckets[index]->capacity) {
-            int new_cap = buckets[index]->capacity * 2;
-            float *new_ptr = realloc(buckets[index]->returns, new_cap * sizeof(float));
-            if (new_ptr == NULL) return 1;
-
-            buckets[index]->returns = new_ptr;
-            buckets[index]->capacity = new_cap;
+    }
+    else{
+        if (ingest_file(input_data) != 0){
+            return engine_exit(1);
         }
-
-        buckets[index]->returns[buckets[index]->day_count] = current_entry.value;
-        buckets[index]->day_count++;
+        fclose(input_data);
+    }
+    phase_end(PHASE_INGESTION);
+    //Snapshot builds stop here: the parsed dataset is the product.
+    if (options.snapshot_path != NULL){
+        return engine_exit(snapshot_write(options.snapshot_path));
+    }
+    //Batch runs analyse every asset instead of looking one up.
+    if (options.all){
+        return engine_exit(analyze_all());
     }
     // Phase 3: Target Data Retrieval
-    index = hash(argv[2]);
+    phase_begin(PHASE_RETRIEVAL);
+    index = hash(user_query);
     if (buckets[index] == NULL) {
-        return 3; // Target investment type not found in dataset
+        return engine_exit(3); // Target investment type not found in dataset
+    }
+    phase_end(PHASE_RETRIEVAL);
+    // Phase 4 and 5: Statistical Analysis and Predictive Modeling
+    test = analyze_bucket(index, &temp_data, options.histogram ? &histogram : NULL, NULL);
+    if (test != 0){
+        return engine_exit(test);
+    }
+    // Phase 6: Cross-Platform Communication
+    phase_begin(PHASE_OUTPUT);
+    test = send2python(buckets[index], user_query);
+    if (test == 1){
+        return engine_exit(3);
+    }
+    if (options.histogram && send_histogram(buckets[index], &histogram) != 0){
+        return engine_exit(1);
+    }
+    phase_end(PHASE_OUTPUT);
+    // Cleanup
+    free(temp_data);
+    return engine_exit(0);
+}
+#endif
+
+/**
+ * Runs the statistics and modeling phases for one bucket: mean, deviation,
+ * the Monte Carlo simulation with its tail select, and the Riemann scan.
+ * Shared by main() and the daemon, which analyses every bucket in turn.
+ * * @param index: Bucket to analyse (must be non-NULL).
+ * @param simulated: Receives the SIM_SAMPLES simulated returns (reordered by the
+ * select, order not meaningful); the caller frees them. Untouched on error.
+ * @param histogram: Receives the histogram of the simulated returns, binned during
+ * generation (NULL to skip).
+ * @param generated: Receives a copy of the SIM_SAMPLES simulated returns in generation
+ * order, taken before the select (NULL to skip).
+ * @return: 0 on success, 1 on allocation failure, 2 if the data has no variance.
+ */
+int analyze_bucket(int index, float** simulated, ShmHistogram* histogram, float* generated){
+    float average;
+    float sdev;
+
+    phase_begin(PHASE_STATISTICS);
+    //The pipeline already accumulated the moments while the file was being read.
+    Moments *ready = &ingest_moments[index];
+    phase_begin(STEP_MEAN);
+    if (ready->count > 0 && ready->count == buckets[index]->day_count){
+        average = ready->mean;
+    }
+    else{
+        average = mean(buckets[index]->returns, buckets[index]->day_count);
     }
-    // Phase 4: Statistical Analysis
-    average = mean(buckets[index]->returns, buckets[index]->day_count);
+    phase_end(STEP_MEAN);
     buckets[index]->mean = average;
-    sdev = stand_dev(buckets[index]->returns, buckets[index]->day_count, average);
+    phase_begin(STEP_STAND_DEV);
+    if (ready->count > 1 && ready->count == buckets[index]->day_count){
+        sdev = sqrt(ready->m2 / (ready->count - 1));
+    }
+    else{
+        sdev = stand_dev(buckets[index]->returns, buckets[index]->day_count, average);
+    }
+    phase_end(STEP_STAND_DEV);
     if (sdev == 0.0){
         return 2;
     }
     buckets[index]->std_dev = sdev;
+    phase_end(PHASE_STATISTICS);
     // Phase 5: Predictive Modeling (Monte Carlo & Riemann)
-    temp_data = synth_data_generator(average, sdev);
-    analyze(temp_data, buckets[index]);
+    phase_begin(PHASE_MODELING);
+    phase_begin(STEP_SIMULATION);
+    *simulated = synth_data_binned(average, sdev, SIM_SAMPLES, histogram);
+    if (*simulated == NULL){
+        return 1;
+    }
+    samples_generated += SIM_SAMPLES;
+    if (generated != NULL){
+        memcpy(generated, *simulated, sizeof(float) * SIM_SAMPLES);
+    }
+    phase_end(STEP_SIMULATION);
+    phase_begin(STEP_SORT);
+    analyze(*simulated, SIM_SAMPLES, buckets[index]);
+    phase_end(STEP_SORT);
+    phase_begin(STEP_RIEMANN);
     rieman(buckets[index]->returns, average, sdev, buckets[index]);
-    // Phase 6: Cross-Platform Communication
-    test = send2python(buckets[index], argv[2]);
-    if (test == 1){
+    phase_end(STEP_RIEMANN);
+    phase_end(PHASE_MODELING);
+    return 0;
+}
+
+/**
+ * Batch mode: analyses every asset of the dataset (or every one --assets lists) in
+ * bucket order and writes one result per asset, so one ingestion serves all of them.
+ * Assets without variance are left out (a single-asset run reports their math error),
+ * as are listed types the dataset lacks; the caller matches records by type name.
+ * * @return: 0 if at least one result was written, 1 on allocation or write failure,
+ * 2 if every asset lacked variance, 3 if no requested asset is in the dataset.
+ */
+int analyze_all(void){
+    int written = 0;
+    int found = 0;
+
+    for (int index = 0; index < TABLE_SIZE; index++){
+        float *simulated;
+        ShmHistogram histogram;
+        if (buckets[index] == NULL || !asset_selected(index)){
+            continue;
+        }
+        found++;
+        int status = analyze_bucket(index, &simulated, options.histogram ? &histogram : NULL, NULL);
+        if (status == 2){
+            continue;
+        }
+        if (status != 0){
+            return status;
+        }
+        phase_begin(PHASE_OUTPUT);
+        status = send2python(buckets[index], buckets[index]->type_name);
+        if (status == 0 && options.histogram){
+            status = send_histogram(buckets[index], &histogram);
+        }
+        phase_end(PHASE_OUTPUT);
+        free(simulated);
+        if (status != 0){
+            return 1;
+        }
+        written++;
+    }
+    if (found == 0){
         return 3;
     }
-    // Cleanup
-    free(temp_data);
-    return 0;
+    return written ? 0 : 2;
 }
 
+/**
+ * Checks a bucket against the --assets list. Types are matched the way a single-asset
+ * query is, by hash, so listing a type twice (or in another case) selects it once.
+ * * @param index: The bucket to check.
+ * @return: 1 if the bucket is to be analysed, 0 otherwise.
+ */
+int asset_selected(int index){
+    char type[20];
+
+    if (options.assets == NULL){
+        return 1;
+    }
+    for (const char *start = options.assets; ; ){
+        size_t length = strcspn(start, ",");
+        //Over-long names are truncated exactly as the parser truncates them.
+        size_t kept = length < sizeof(type) - 1 ? length : sizeof(type) - 1;
+        memcpy(type, start, kept);
+        type[kept] = '\0';
+        if (kept > 0 && hash(type) == index){
+            return 1;
+        }
+        if (start[length] == '\0'){
+            return 0;
+        }
+        start += length + 1;
+    }
+}
 
 /**
  * Parses a single line from the CSV file and populates a RawData structure.
  * * @param line: The raw string read from the file.
  * @param data: Pointer to the RawData struct where parsed info will be stored.
+ * @return: 0 on success, 1 if the line has no "type,value" shape (data untouched).
  */
-void load(char* line, RawData* data ){
+int load(char* line, RawData* data ){
     // Isolate the first token (Investment Type)
-    char *type = strtok(line, ",");
-    if (type == NULL) return;
+    char *comma = strchr(line, ',');
+    if (comma == NULL) return 1;
+    return parse_line(line, comma, line + strlen(line), data);
+}
 
+/**
+ * Splits a delimited line into its type and return value.
+ * Shared by load() and the block ingestion path, which finds the delimiters
+ * with the SIMD scan instead of strtok.
+ * * @param line: First byte of the line.
+ * @param comma: The first ',' in the line.
+ * @param end: One past the last byte of the line (the '\n' or end of input).
+ * @param data: Pointer to the RawData struct where parsed info will be stored.
+ * @return: 0 on success, 1 if the type is empty (data untouched).
+ */
+int parse_line(const char* line, const char* comma, const char* end, RawData* data){
     //DATA INTEGRITY FIX:
      //Remove trailing newline or carriage return characters (\r\n).
      //If these remain, the hash() function will treat "S&P500\n"
      //differently than "S&P500", breaking bucket lookups.
-    type[strcspn(type, "\r\n")] = 0;
-
-    // Isolate the second token (Return Value)
-    char *return_str = strtok(NULL, ",");
-    if (return_str == NULL) return;
+    size_t length = 0;
+    while (line + length < comma && line[length] != '\r' && line[length] != '\n'){
+        length++;
+    }
+    if (length == 0) return 1;
+    //Names longer than the struct allows are truncated rather than overflowing it.
+    if (length > sizeof(data->type) - 1){
+        length = sizeof(data->type) - 1;
+    }
     // Transfer the data to the struct
-    strcpy(data->type, type);
-    data->value = atof(return_str);
+    memcpy(data->type, line, length);
+    data->type[length] = '\0';
+    data->value = parse_return(comma + 1, end);
+    return 0;
 }
 
+/**
+ * Converts decimal text to a float exactly as atof() would (atof then cast).
+ * * @param text: First byte of the field.
+ * @param end: One past the last byte the field may use.
+ * @return: The parsed value, 0 if the text is not a number (like atof).
+ */
+float parse_return(const char* text, const char* end){
+    return (float)parse_decimal(text, end);
+}
 
 /**
- * Generates a consistent hash index for a given asset string.
- * This ensures that specific investment types are always routed
- * to the same portfolio bucket.
- * * @param type: The raw string identifier for the investment.
- * @return: An integer index between 0 and (TABLE_SIZE - 1).
+ * Converts decimal text to a double exactly as strtod() would.
+ * Plain decimals with up to 19 significant digits and a power of ten within
+ * 10^22 take Clinger's fast path: the mantissa and the power are both exact
+ * doubles, so one multiply or divide is correctly rounded. Anything else (more
+ * digits, huge exponents, inf/nan, hex) is handed to strtod.
+ * * @param text: First byte of the field.
+ * @param end: One past the last byte the field may use.
+ * @return: The parsed value, 0 if the text is not a number (like atof).
  */
-int hash(char* type){
-    //Initialize with a large prime to provide a head start for distribution
-    long total = 5381;
-    char upperchar;
-    int charint;
+double parse_decimal(const char* text, const char* end){
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char *p = text;
+    int negative = 0;
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
 
-    for (int i = 0; type[i] != '\0'; i++){
-        //Normalize to uppercase for case-insensitivity
-        upperchar = toupper(type[i]);
-        //Calculate numeric weight based on alphabet position
-        charint = (int)upperchar-'A';
-        //Offset adjustment to ensure 'A' (0) still contributes to the hash
-        if (charint == 0){
-            charint = 3;
+    while (p < end && (*p == ' ' || *p == '\t')){
+        p++;
+    }
+    if (p < end && (*p == '-' || *p == '+')){
+        negative = (*p == '-');
+        p++;
+    }
+    const char *number = p;
+    while (p < end && *p >= '0' && *p <= '9'){
+        if (mantissa == 0 && *p == '0'){
+            p++;
+            continue;
         }
-        //Multiplying by 33 (shifting and adding) helps spread the
-        //bits of the previous characters across the total.
-        total = (total * 33)+charint;
+        if (digits >= 19) goto slow_path;
+        mantissa = mantissa * 10 + (*p++ - '0');
+        digits++;
     }
-    //Wrap the result within the bounds of the hash table
-    int index = total % TABLE_SIZE;
-    if (index < 0){
-        index = index * -1;
+    if (p < end && *p == '.'){
+        p++;
+        while (p < end && *p >= '0' && *p <= '9'){
+            if (mantissa == 0 && *p == '0'){
+                exponent--;
+                p++;
+                continue;
+            }
+            if (digits >= 19) goto slow_path;
+            mantissa = mantissa * 10 + (*p++ - '0');
+            digits++;
+            exponent--;
+        }
+    }
+    //A leading letter may be inf/nan/hex, which atof accepts; let strtod decide.
+    if (p == number || (p == number + 1 && *number == '.')){
+        if (p < end && isalpha((unsigned char)*p)) goto slow_path;
+        return 0;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')){
+        const char *mark = p++;
+        int exp_negative = 0;
+        int exp_value = 0;
+        if (p < end && (*p == '-' || *p == '+')){
+            exp_negative = (*p == '-');
+            p++;
+        }
+        if (p < end && *p >= '0' && *p <= '9'){
+            while (p < end && *p >= '0' && *p <= '9'){
+                if (exp_value > 10000) goto slow_path;
+                exp_value = exp_value * 10 + (*p++ - '0');
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+        }
+        else{
+            //"1e" or "1e+" : the exponent marker is ignored, as strtod does.
+            p = mark;
+        }
+    }
+    //Hex floats ("0x...") look like a zero followed by garbage to the loop above.
+    if (p < end && (*p == 'x' || *p == 'X')) goto slow_path;
+    if (mantissa == 0){
+        return negative ? -0.0 : 0.0;
+    }
+    if (mantissa > (1ULL << 53) || exponent < -22 || exponent > 22) goto slow_path;
+    {
+        double value = (double)mantissa;
+        value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+        return negative ? -value : value;
     }
-    return index;
-}
 
+slow_path:
+    {
+        //strtod needs a terminated string; fields longer than a line buffer are not numbers anyway.
+        char field[SIZE_LINE];
+        size_t length = end - text;
+        if (length > sizeof(field) - 1){
+            length = sizeof(field) - 1;
+        }
+        memcpy(field, text, length);
+        field[length] = '\0';
+        return strtod(field, NULL);
+    }
+}
 
 /**
- * Allocates and initializes a new Portfolio bucket.
- * * @param type: The string label for the investment type.
- * @return: A pointer to the initialized Portfolio, or NULL on failure.
+ * Adds one parsed entry to a hash table: the global buckets, or one input's own table.
+ * * @param table: TABLE_SIZE bucket slots.
+ * @param entry: The type and value of one CSV row.
+ * @return: 0 on success, 1 on allocation failure.
  */
-Portfolio* create_bucket(char *type){
-    // Step 1: Allocate the primary structure
-    Portfolio* bucket = malloc(sizeof(Portfolio));
-    // Safety check: ensure the OS granted the memory request
-    if (bucket == NULL){
-        free(bucket);
-        return NULL;
+static inline int table_store(Portfolio** table, RawData* entry){
+    int index = hash(entry->type);
+    //Initialization of hash table buckets
+    if (table[index] == NULL) {
+        table[index] = create_bucket(entry->type);
+        if (table[index] == NULL) return 1;
     }
-    // Step 2: Allocate the dynamic array for historical returns
-    // Starting with a baseline capacity of 50 entries
-    bucket->returns = malloc(sizeof(float)*50);
-    // cleanup to avoid memory leak
-    if (bucket->returns == NULL){
-        free(bucket);
-        return NULL;
+
+    // Dynamic Array Resizing to avoid memory leak or segmentation fault.
+    if (table[index]->day_count >= table[index]->capacity) {
+        int new_cap = table[index]->capacity * 2;
+        float *new_ptr = realloc(table[index]->returns, new_cap * sizeof(float));
+        if (new_ptr == NULL) return 1;
+
+        table[index]->returns = new_ptr;
+        table[index]->capacity = new_cap;
+    }
+
+    table[index]->returns[table[index]->day_count] = entry->value;
+    table[index]->day_count++;
+    return 0;
+}
+
+/**
+ * Adds one parsed entry to the global hash table.
+ * * @param entry: The type and value of one CSV row.
+ * @return: 0 on success, 1 on allocation failure.
+ */
+int store_entry(RawData* entry){
+    if (table_store(buckets, entry) != 0) return 1;
+    rows_ingested++;
+    return 0;
+}
+
+/**
+ * Parses every complete line of a buffer, handing each well-formed row to 'emit'.
+ * Shared by ingest_stream() and the pipeline's parser stage.
+ * * @param at_end: 1 if nothing follows the buffer, so a last line without '\n' counts.
+ * @param commas: Scratch for length/64 + 1 words of bit masks (newlines likewise).
+ * @param emit: Receives each row; a non-zero return stops the parse.
+ * @param consumed: Set to the offset of the first byte not yet parsed (a partial line).
+ * @return: 0 on success, 1 if emit failed.
+ */
+static inline int parse_block(const char* buffer, size_t length, int at_end, uint64_t* commas, uint64_t* newlines,
+                              int (*emit)(RawData* entry, void* context), void* context, size_t* consumed){
+    RawData entry;
+    size_t line_start = 0;
+    size_t comma = SIZE_MAX;
+
+    kernels.scan_delimiters(buffer, length, commas, newlines);
+    for (size_t word = 0; word * 64 < length; word++){
+        uint64_t bits = commas[word] | newlines[word];
+        while (bits != 0){
+            int bit = __builtin_ctzll(bits);
+            size_t position = word * 64 + bit;
+            bits &= bits - 1;
+            if (newlines[word] & (1ULL << bit)){
+                if (comma != SIZE_MAX && parse_line(buffer + line_start, buffer + comma, buffer + position, &entry) == 0
+                    && emit(&entry, context) != 0){
+                    return 1;
+                }
+                line_start = position + 1;
+                comma = SIZE_MAX;
+            }
+            else if (comma == SIZE_MAX){
+                comma = position;
+            }
+        }
+    }
+    //The final line of a file may lack its newline.
+    if (at_end && line_start < length){
+        if (comma != SIZE_MAX && parse_line(buffer + line_start, buffer + comma, buffer + length, &entry) == 0
+            && emit(&entry, context) != 0){
+            return 1;
+        }
+        line_start = length;
+    }
+    *consumed = line_start;
+    return 0;
+}
+
+static int emit_store(RawData* entry, void* context){
+    (void)context;
+    return store_entry(entry);
+}
+
+static int stream_rows(FILE* input, int (*emit)(RawData* entry, void* context), void (*chunk_done)(void* context),
+                       void* context);
+
+//Ingests a CSV stream into the buckets (stream_rows() with store_entry() as the sink).
+int ingest_stream(FILE* input){
+    return stream_rows(input, emit_store, NULL, NULL);
+}
+
+/**
+ * Reads a CSV stream in READ_BLOCK chunks, handing every well-formed row to 'emit'.
+ * Each chunk is classified by the scan_delimiters kernel into comma/newline bit
+ * masks; the loop then jumps from delimiter to delimiter instead of testing every
+ * byte. A line cut by the chunk boundary is carried to the front of the buffer
+ * (which doubles if a single line outgrows it). Lines without a comma or with an
+ * empty type are skipped. The sink is a parameter so other consumers (the
+ * out-of-core passes, the multi-file tables) reuse the same parser.
+ * * @param input: An open CSV stream.
+ * @param emit: Receives each row; a non-zero return stops the read.
+ * @param chunk_done: Called after each READ_BLOCK chunk is parsed (NULL for none).
+ * @return: 0 on success, 1 on allocation failure or if emit failed.
+ */
+static int stream_rows(FILE* input, int (*emit)(RawData* entry, void* context), void (*chunk_done)(void* context),
+                       void* context){
+    size_t capacity = READ_BLOCK;
+    size_t filled = 0;
+    char *buffer = malloc(capacity);
+    uint64_t *commas = malloc(sizeof(uint64_t) * (capacity / 64 + 1));
+    uint64_t *newlines = malloc(sizeof(uint64_t) * (capacity / 64 + 1));
+    int status = 0;
+
+    if (buffer == NULL || commas == NULL || newlines == NULL){
+        status = 1;
+        goto done;
+    }
+    for (;;){
+        size_t got = fread(buffer + filled, 1, capacity - filled, input);
+        int at_end = (got == 0);
+        size_t line_start;
+        filled += got;
+
+        if (parse_block(buffer, filled, at_end, commas, newlines, emit, context, &line_start) != 0){
+            status = 1;
+            goto done;
+        }
+        if (chunk_done != NULL){
+            chunk_done(context);
+        }
+        if (at_end){
+            break;
+        }
+        memmove(buffer, buffer + line_start, filled - line_start);
+        filled -= line_start;
+        if (filled == capacity){
+            capacity *= 2;
+            char *grown = realloc(buffer, capacity);
+            uint64_t *grown_commas = realloc(commas, sizeof(uint64_t) * (capacity / 64 + 1));
+            uint64_t *grown_newlines = realloc(newlines, sizeof(uint64_t) * (capacity / 64 + 1));
+            if (grown != NULL) buffer = grown;
+            if (grown_commas != NULL) commas = grown_commas;
+            if (grown_newlines != NULL) newlines = grown_newlines;
+            if (grown == NULL || grown_commas == NULL || grown_newlines == NULL){
+                status = 1;
+                goto done;
+            }
+        }
+    }
+
+done:
+    free(buffer);
+    free(commas);
+    free(newlines);
+    return status;
+}
+
+
+/**
+ * Generates a consistent hash index for a given asset string.
+ * This ensures that specific investment types are always routed
+ * to the same portfolio bucket.
+ * * @param type: The raw string identifier for the investment.
+ * @return: An integer index between 0 and (TABLE_SIZE - 1).
+ */
+int hash(char* type){
+    //Initialize with a large prime to provide a head start for distribution
+    long total = 5381;
+    char upperchar;
+    int charint;
+
+    for (int i = 0; type[i] != '\0'; i++){
+        //Normalize to uppercase for case-insensitivity
+        upperchar = toupper(type[i]);
+        //Calculate numeric weight based on alphabet position
+        charint = (int)upperchar-'A';
+        //Offset adjustment to ensure 'A' (0) still contributes to the hash
+        if (charint == 0){
+            charint = 3;
+        }
+        //Multiplying by 33 (shifting and adding) helps spread the
+        //bits of the previous characters across the total.
+        total = (total * 33)+charint;
+    }
+    //Wrap the result within the bounds of the hash table
+    int index = total % TABLE_SIZE;
+    if (index < 0){
+        index = index * -1;
+    }
+    return index;
+}
+
+
+/**
+ * Allocates and initializes a new Portfolio bucket.
+ * * @param type: The string label for the investment type.
+ * @return: A pointer to the initialized Portfolio, or NULL on failure.
+ */
+Portfolio* create_bucket(char *type){
+    // Step 1: Allocate the primary structure
+    Portfolio* bucket = malloc(sizeof(Portfolio));
+    // Safety check: ensure the OS granted the memory request
+    if (bucket == NULL){
+        free(bucket);
+        return NULL;
+    }
+    // Step 2: Allocate the dynamic array for historical returns
+    // Starting with a baseline capacity of 50 entries
+    bucket->returns = malloc(sizeof(float)*50);
+    // cleanup to avoid memory leak
+    if (bucket->returns == NULL){
+        free(bucket);
+        return NULL;
     }
 
     // Step 3: Initialize metadata and defaults
@@ -247,10 +1488,27 @@ Portfolio* create_bucket(char *type){
     bucket->std_dev = 0.0f;
     bucket->worst_case = 0.0f;
     bucket->worst_case_rieman = 0.0f;
+    bucket->worst_case_historical = NAN;
 
     return bucket;
 }
 
+//Chunk bodies for parallel_reduce: the bound moment kernels over one index range.
+static double sum_range(void* arg, long begin, long end){
+    return kernels.sum((const float*)arg + begin, (int)(end - begin));
+}
+
+//Inputs of the squared-deviation reduction.
+typedef struct {
+    const float *data;
+    float mean;
+} DeviationJob;
+
+static double sum_sq_dev_range(void* arg, long begin, long end){
+    DeviationJob *job = arg;
+    return kernels.sum_sq_dev(job->data + begin, (int)(end - begin), job->mean);
+}
+
 /**
  * Calculates the average historical return for a specific asset.
  * * @param data: Pointer to the array of float return values.
@@ -266,11 +1524,9 @@ float mean(float* data, int count){
     //In MLOps (my study of passion is macheine learning), accumulating thousands of small floats can lead to
     //rounding errors if the accumulator doesn't have enough significant digits.
     double total_value = 0;
-    // Summing the historical performance data
-    for (int i = 0; i < count; i++){
-        //add the return float to total_value
-        total_value += data[i];
-    }
+    // Summing the historical performance data (vectorised by the bound sum kernel,
+    // split across the pool in REDUCE_GRAIN chunks once the dataset is that large)
+    total_value = parallel_reduce(count, REDUCE_GRAIN, sum_range, data);
     // Calculate final mean and return as float
     float mean = total_value/count;
     return mean;
@@ -293,11 +1549,9 @@ float stand_dev(float* data, int count, float mean){
     //Squaring differences ensures that negative deviations (losses)
     //don't cancel out positive deviations (gains).
     double total_value = 0;
-    //create a for loop that loops until it hits day_count
-    for (int i =0; i < count; i++){
-        //subtract the mean from the return and square it in case of negitive value to add variance
-        total_value += (data[i]-mean) * (data[i]-mean);
-    }
+    //subtract the mean from each return and square it (vectorised by the bound sum_sq_dev kernel)
+    DeviationJob job = {data, mean};
+    total_value = parallel_reduce(count, REDUCE_GRAIN, sum_sq_dev_range, &job);
 
      //Using (count - 1) provides an unbiased estimate of the
      //population variance when working with sample data.
@@ -307,41 +1561,125 @@ float stand_dev(float* data, int count, float mean){
 }
 
 /**
- * Generates a synthetic dataset of 10,000 points based on asset statistics.
+ * Bins simulated returns over mean +/- 4 deviations, where all but ~1 in 15,000
+ * normal draws fall; anything outside is counted in the nearest edge bin.
+ */
+void histogram_reset(ShmHistogram* histogram, double mean, double deviation){
+    histogram->bins = SHM_HISTOGRAM_BINS;
+    histogram->low = mean - 4 * deviation;
+    histogram->high = mean + 4 * deviation;
+    histogram->total = 0;
+    memset(histogram->counts, 0, sizeof(histogram->counts));
+}
+
+void histogram_add(ShmHistogram* histogram, const float* samples, int count){
+    //Single precision like the samples, clamped with min/max instead of branches.
+    float low = (float)histogram->low;
+    float scale = (float)(SHM_HISTOGRAM_BINS / (histogram->high - histogram->low));
+    for (int i = 0; i < count; i++){
+        float position = (samples[i] - low) * scale;
+        position = position > 0.0f ? position : 0.0f;
+        position = position < SHM_HISTOGRAM_BINS - 1 ? position : SHM_HISTOGRAM_BINS - 1;
+        histogram->counts[(int)position]++;
+    }
+    histogram->total += count;
+}
+
+/**
+ * Draws 'length' samples tile by tile: each SIM_TILE of uniforms is reshaped and, if a
+ * histogram is given, binned before the next tile is drawn, so the samples are binned
+ * straight out of L1 with no second pass over the array. Only the first 'valid' samples
+ * are binned (the rest is Box-Muller padding).
+ */
+static void generate_tiles(EngineRng* rng, float* out, int length, int valid, float mean, float deviation,
+                           ShmHistogram* histogram){
+    for (int start = 0; start < length; start += SIM_TILE){
+        int tile = length - start < SIM_TILE ? length - start : SIM_TILE;
+        kernels.uniforms(rng, out + start, tile);
+        kernels.box_muller(out + start, out + start, tile, mean, deviation);
+        if (histogram != NULL && start < valid){
+            histogram_add(histogram, out + start, valid - start < tile ? valid - start : tile);
+        }
+    }
+}
+
+//Inputs of a parallel simulation; chunk c draws from its own split stream.
+typedef struct {
+    float *out;
+    float mean;
+    float deviation;
+    long padded;
+    long count;
+    //Shared histogram; each chunk bins into a private copy and merges it atomically.
+    ShmHistogram *histogram;
+} SimulationJob;
+
+static void simulate_chunks(void* arg, long begin, long end){
+    SimulationJob *job = arg;
+    EngineRng rng;
+    for (long chunk = begin; chunk < end; chunk++){
+        float *out = job->out + chunk * SIM_CHUNK;
+        int length = (int)((chunk + 1) * SIM_CHUNK < job->padded ? SIM_CHUNK : job->padded - chunk * SIM_CHUNK);
+        long remaining = job->count - chunk * SIM_CHUNK;
+        int valid = remaining < length ? (int)(remaining > 0 ? remaining : 0) : length;
+        ShmHistogram local;
+        if (job->histogram != NULL){
+            histogram_reset(&local, 0, 0);
+            local.low = job->histogram->low;
+            local.high = job->histogram->high;
+        }
+        rng_split(&engine_rng, &rng, chunk);
+        generate_tiles(&rng, out, length, valid, job->mean, job->deviation, job->histogram != NULL ? &local : NULL);
+        if (job->histogram != NULL){
+            for (int bin = 0; bin < SHM_HISTOGRAM_BINS; bin++){
+                __atomic_fetch_add(&job->histogram->counts[bin], local.counts[bin], __ATOMIC_RELAXED);
+            }
+            __atomic_fetch_add(&job->histogram->total, local.total, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * Generates a synthetic dataset based on asset statistics.
  * Uses the Box-Muller transform to produce a normal distribution.
  * * @param mean: The target average for the distribution.
  * @param deviation: The target volatility for the distribution.
- * @return: A pointer to a heap-allocated array of 10,000 floats.
+ * @param count: Number of samples to draw (SIM_SAMPLES for the dashboard).
+ * @return: A pointer to a heap-allocated array of 'count' floats.
  */
-float* synth_data_generator(float mean, float deviation){
-    // Allocation for the synthetic 10k sample set
-    float* generated_returns = malloc(sizeof(float)*10000);
+float* synth_data_generator(float mean, float deviation, int count){
+    return synth_data_binned(mean, deviation, count, NULL);
+}
+
+/**
+ * The generator behind synth_data_generator(), optionally histogramming its output.
+ * * @param histogram: Reset to mean +/- 4 deviations and filled with the 'count' samples
+ * while they are generated; NULL to skip.
+ * @return: A pointer to a heap-allocated array of 'count' floats.
+ */
+float* synth_data_binned(float mean, float deviation, int count, ShmHistogram* histogram){
+    //Kernels work on whole Box-Muller blocks, so round the allocation up;
+    //the caller only ever reads the first 'count' samples.
+    int padded = (count + BOX_MULLER_BLOCK - 1) / BOX_MULLER_BLOCK * BOX_MULLER_BLOCK;
+    // Allocation for the synthetic sample set
+    float* generated_returns = malloc(sizeof(float)*padded);
     if (generated_returns == NULL){
         return NULL;
     }
-    //initialize variables for for loop
-    float u1;
-    float u2;
-    float transform_u1;
-    float transform_u2;
-    float gravity;
-
-    //We iterate 5,000 times, generating two points per iteration
-    //to populate the full 10,000-node array.
-    for (int i = 0; i < 10000-1; i+=2){
-        // Generate uniform random numbers in the range (0, 1]
-        u1 = (rand()+1.0)/(RAND_MAX+1.0);
-        u2 = (rand()+1.0)/(RAND_MAX+1.0);
-        /* * BOX-MULLER TRANSFORM:
-         * 'gravity' calculates the magnitude of the offset from the mean.
-         */
-        gravity = sqrtf(-2*logf(u1));
-        // Project magnitude onto the Z-axis using trigonometric oscillation
-        transform_u1 = (gravity*(cosf((PI*2)*u2))*deviation)+mean;
-        transform_u2 = (gravity*(sinf((PI*2)*u2))*deviation)+mean;
-        //add both variables into the array
-        generated_returns[i] = transform_u1;
-        generated_returns[i+1] = transform_u2;
+    if (histogram != NULL){
+        histogram_reset(histogram, mean, deviation);
+    }
+    // Generate uniform random numbers in the range (0, 1], then reshape them in place
+    if (padded <= SIM_CHUNK){
+        generate_tiles(&engine_rng, generated_returns, padded, count, mean, deviation, histogram);
+    }
+    else{
+        //Large runs are cut into SIM_CHUNK pieces with their own streams, so the
+        //samples are the same whichever worker draws each piece.
+        SimulationJob job = {generated_returns, mean, deviation, padded, count, histogram};
+        long chunks = (padded + SIM_CHUNK - 1) / SIM_CHUNK;
+        parallel_for(chunks, 1, simulate_chunks, &job);
+        engine_rng.streams += chunks;
     }
 
     return generated_returns;
@@ -366,18 +1704,22 @@ int compare(const void *a, const void *b){
 
 }
 /**
- * Sorts the synthetic dataset and extracts the 5% Value-at-Risk (VaR).
- * * @param data: The 10,000-point synthetic array.
+ * Extracts the 5% Value-at-Risk (VaR) from the synthetic dataset.
+ * * @param data: The synthetic array.
+ * @param count: Number of samples in the array.
  * @param bucket: The Portfolio structure to update with the result.
  */
-void analyze(float* data, Portfolio* bucket){
+void analyze(float* data, int count, Portfolio* bucket){
 
-    //Using qsort (O(n log n)) ensures the analysis remains efficient
-    //even as we scale the simulation size.
-    qsort(data, 10000, sizeof(float), &compare);
     //Index 499 represents the 5th percentile of 10,000 samples.
     //This is our "Monte Carlo" Worst Case Scenario.
-    float worst_case = data[499];
+    int tail_index = (int)(count * VAR_LEVEL) - 1;
+    if (tail_index < 0){
+        tail_index = 0;
+    }
+    //Only one order statistic is needed, so a selection (O(n)) replaces the
+    //full qsort (O(n log n)); it leaves data partially reordered.
+    float worst_case = kernels.select(data, count, tail_index);
      // Update the portfolio metadata with the calculated risk profile
     bucket->worst_case = worst_case;
 }
@@ -394,26 +1736,27 @@ void rieman(float* data, float mean, float deviation, Portfolio* adress){
     // Cumulative area accumulator (target is 0.05 or 5%)
     float bucket = 0;
     // Start scanning from the extreme left tail of the bell curve.
-    float start = mean-(5*deviation);
+    float x = mean-(5*deviation);
     float step_size = 0.0001;
-    //initialize variables for loop
-    float height;
-    float x;
-    float z;
-    //Continues until the 'bucket' (area) reaches 0.05.
-    for (x = start; bucket < 0.05; x+=step_size){
-        // Calculate the Z-Score (distance from mean in standard deviations)
-        z = (x-mean)/deviation;
+    //A block of rectangle positions and their heights, so the density runs in vector lanes.
+    float steps[RIEMANN_BLOCK];
+    float heights[RIEMANN_BLOCK];
 
-        /* * GAUSSIAN HEIGHT CALCULATION:
-         * 1. (z*z) squares the distance to remove negative signs.
-         * 2. expf(-0.5 * z^2) creates the characteristic bell shape.
-         * 3. INV_SQRT_2PI / deviation normalizes the total area to 1.0.
-         */
-        height = INV_SQRT_2PI/deviation*(expf(-0.5*(z*z)));
+    //Continues until the 'bucket' (area) reaches 0.05.
+    while (bucket < 0.05){
+        //x advances by repeated float addition, exactly as the one-step-at-a-time loop did.
+        float next = x;
+        for (int i = 0; i < RIEMANN_BLOCK; i++){
+            steps[i] = next;
+            next += step_size;
+        }
+        kernels.gaussian_density(steps, heights, RIEMANN_BLOCK, mean, deviation);
 
-        // Accumulate the area of the current rectangle (Height * Base)
-        bucket += height*step_size;
+        // Accumulate the area of each rectangle (Height * Base); a block may overshoot the target.
+        for (int i = 0; i < RIEMANN_BLOCK && bucket < 0.05; i++){
+            bucket += heights[i]*step_size;
+            x += step_size;
+        }
     }
     //update the buckets worst_case_rieman
     adress->worst_case_rieman = x;
@@ -431,6 +1774,35 @@ int send2python(Portfolio* ptr, char* user_query){
     if (ptr == NULL){
         return 1;
     }
+    /* * CROSS-LANGUAGE BRIDGE:
+     * Data is piped to Python via stdout as one binary ResultRecord, decoded by
+     * engine_protocol.py. --csv keeps the legacy text line:
+     * Format: Type, Mean, Stability, Min_VaR, Max_VaR
+     */
+    if (options.csv){
+        float stability;
+        float min_percentage;
+        float max_percentage;
+        risk_scores(ptr, &stability, &min_percentage, &max_percentage);
+        printf("%s,%.4f,%.4f,%.4f,%.4f\n", ptr->type_name, ptr->mean, stability, min_percentage, max_percentage);
+        return 0;
+    }
+    ResultRecord record;
+    encode_result(ptr, &record);
+    if (fwrite(&record, sizeof(record), 1, stdout) != 1 || fflush(stdout) != 0){
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Derives the dashboard figures from an analysed bucket.
+ * * @param ptr: Pointer to the analyzed Portfolio bucket.
+ * @param stability: Receives the 0-100 stability score (inverted volatility).
+ * @param min_percentage: Receives the lower VaR bound in percent.
+ * @param max_percentage: Receives the upper VaR bound in percent.
+ */
+void risk_scores(Portfolio* ptr, float* stability, float* min_percentage, float* max_percentage){
     float min;
     float max;
 
@@ -448,15 +1820,3158 @@ int send2python(Portfolio* ptr, char* user_query){
     float floor = 0.0;
     float cap = 1;
     // Converts raw return values into human-readable percentages.
-    float min_percentage = ((min-floor)/(cap-floor))*100;
-    float max_percentage = ((max-floor)/(cap-floor))*100;
+    *min_percentage = ((min-floor)/(cap-floor))*100;
+    *max_percentage = ((max-floor)/(cap-floor))*100;
     //Inverts the standard deviation (volatility) to create a 0-100 score.
     float score = ptr->std_dev;
-    float stability = 100-(((score-floor)/(cap-floor))*100);
-    /* * CROSS-LANGUAGE BRIDGE:
-     * Data is piped to Python via stdout in a structured CSV format.
-     * Format: Type, Mean, Stability, Min_VaR, Max_VaR
-     */
-    printf("%s,%.4f,%.4f,%.4f,%.4f\n", ptr->type_name, ptr->mean, stability, min_percentage, max_percentage);
+    *stability = 100-(((score-floor)/(cap-floor))*100);
+}
+
+/**
+ * Packs an analysed bucket into the fixed binary layout.
+ * * @param ptr: The analysed Portfolio bucket.
+ * @param record: Receives the record, ready to write as-is.
+ */
+void encode_result(Portfolio* ptr, ResultRecord* record){
+    float stability;
+    float min_percentage;
+    float max_percentage;
+
+    risk_scores(ptr, &stability, &min_percentage, &max_percentage);
+    memset(record, 0, sizeof(*record));
+    record->length = sizeof(*record) - sizeof(record->length);
+    record->version = RESULT_SCHEMA_VERSION;
+    //strncpy zero-fills the tail, so no stale bytes reach the wire.
+    strncpy(record->type_name, ptr->type_name, sizeof(record->type_name));
+    record->day_count = ptr->day_count;
+    record->mean = ptr->mean;
+    record->stability = stability;
+    record->min_var = min_percentage;
+    record->max_var = max_percentage;
+    record->std_dev = ptr->std_dev;
+    record->worst_case = ptr->worst_case;
+    record->worst_case_rieman = ptr->worst_case_rieman;
+    record->worst_case_historical = ptr->worst_case_historical;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    //The wire format is little-endian; swap every field in place on big-endian hosts.
+    record->length = __builtin_bswap32(record->length);
+    record->version = __builtin_bswap16(record->version);
+    record->day_count = __builtin_bswap32(record->day_count);
+    double *fields[] = {&record->mean, &record->stability, &record->min_var, &record->max_var,
+                        &record->std_dev, &record->worst_case, &record->worst_case_rieman,
+                        &record->worst_case_historical};
+    for (int i = 0; i < 8; i++){
+        uint64_t bits;
+        memcpy(&bits, fields[i], sizeof(bits));
+        bits = __builtin_bswap64(bits);
+        memcpy(fields[i], &bits, sizeof(bits));
+    }
+#endif
+}
+
+/**
+ * Writes an analysed bucket's histogram as a HistogramRecord on stdout (little-endian,
+ * like the ResultRecord it follows).
+ * * @param ptr: The analysed bucket (for its name).
+ * @param histogram: Its simulated-return histogram.
+ * @return: 0 on success, 1 if stdout failed.
+ */
+int send_histogram(Portfolio* ptr, const ShmHistogram* histogram){
+    HistogramRecord record;
+
+    //The legacy text line has no histogram counterpart.
+    if (options.csv){
+        return 0;
+    }
+    memset(&record, 0, sizeof(record));
+    record.length = sizeof(record) - sizeof(record.length);
+    record.version = RESULT_SCHEMA_VERSION;
+    record.kind = RECORD_KIND_HISTOGRAM;
+    memcpy(record.type_name, ptr->type_name, strnlen(ptr->type_name, sizeof(record.type_name) - 1));
+    record.bins = SHM_HISTOGRAM_BINS;
+    record.low = histogram->low;
+    record.high = histogram->high;
+    record.total = (uint32_t)histogram->total;
+    memcpy(record.counts, histogram->counts, sizeof(record.counts));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    record.length = __builtin_bswap32(record.length);
+    record.version = __builtin_bswap16(record.version);
+    record.kind = __builtin_bswap16(record.kind);
+    record.bins = __builtin_bswap32(record.bins);
+    record.total = __builtin_bswap32(record.total);
+    double *bounds[] = {&record.low, &record.high};
+    for (int i = 0; i < 2; i++){
+        uint64_t bits;
+        memcpy(&bits, bounds[i], sizeof(bits));
+        bits = __builtin_bswap64(bits);
+        memcpy(bounds[i], &bits, sizeof(bits));
+    }
+    for (int bin = 0; bin < SHM_HISTOGRAM_BINS; bin++){
+        record.counts[bin] = __builtin_bswap32(record.counts[bin]);
+    }
+#endif
+    if (fwrite(&record, sizeof(record), 1, stdout) != 1 || fflush(stdout) != 0){
+        return 1;
+    }
+    return 0;
+}
+
+
+/**
+ * Separates the positional arguments from the optional switches.
+ * Switches may appear anywhere after the program name, up to a "--" argument: everything
+ * after it is positional, so a dataset or asset type may itself start with "--".
+ * Several dataset files may precede the asset type (options.inputs lists them all).
+ * * @param csv_path: Receives the first positional argument (the dataset, or the feed source with --stream).
+ * @param user_query: Receives the last positional argument (the asset type; absent with --stream).
+ * @return: 0 on success, 1 on incorrect usage.
+ */
+int parse_options(int argc, char* argv[], char** csv_path, char** user_query){
+    int positional = 0;
+    int switches = 1;
+    char **positionals = malloc(sizeof(char*) * argc);
+
+    if (positionals == NULL){
+        return 1;
+    }
+    for (int i = 1; i < argc; i++){
+        if (switches && strcmp(argv[i], "--") == 0){
+            switches = 0;
+        }
+        else if (!switches || strncmp(argv[i], "--", 2) != 0){
+            //Positional arguments keep their original order: files first, then type.
+            positionals[positional++] = argv[i];
+        }
+        else if (strcmp(argv[i], "--timings") == 0){
+            options.timings = 1;
+        }
+        else if (strcmp(argv[i], "--perf-counters") == 0){
+            options.perf_counters = 1;
+        }
+        else if (strcmp(argv[i], "--all") == 0){
+            options.all = 1;
+        }
+        else if (strcmp(argv[i], "--histogram") == 0){
+            options.histogram = 1;
+        }
+        else if (strcmp(argv[i], "--out-of-core") == 0){
+            options.out_of_core = 1;
+        }
+        else if (strcmp(argv[i], "--assets") == 0 && i + 1 < argc){
+            options.assets = argv[++i];
+            options.all = 1;
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc){
+            options.trace_id = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+            options.threads = atoi(argv[++i]);
+            if (options.threads < 1){
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--pin") == 0){
+            options.pin = 1;
+        }
+        else if (strcmp(argv[i], "--pipeline") == 0){
+            options.pipeline = 1;
+        }
+        else if (strcmp(argv[i], "--csv") == 0){
+            options.csv = 1;
+        }
+        else if (strcmp(argv[i], "--daemon") == 0){
+            options.daemon = 1;
+        }
+        else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc){
+            options.shm_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--shm-samples") == 0){
+            options.shm_samples = 1;
+        }
+        else if (strcmp(argv[i], "--refresh-ms") == 0 && i + 1 < argc){
+            options.refresh_ms = atoi(argv[++i]);
+            if (options.refresh_ms < 1){
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc){
+            options.snapshot_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--append") == 0 && i + 1 < argc){
+            options.append_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--stream") == 0){
+            options.stream = 1;
+        }
+        else if (strcmp(argv[i], "--binary") == 0){
+            options.binary = 1;
+        }
+        else if (strcmp(argv[i], "--prices") == 0){
+            options.prices = 1;
+        }
+        else if (strcmp(argv[i], "--publish-ms") == 0 && i + 1 < argc){
+            options.publish_ms = atoi(argv[++i]);
+            if (options.publish_ms < 0){
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--publish-every") == 0 && i + 1 < argc){
+            options.publish_every = atol(argv[++i]);
+            if (options.publish_every < 0){
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--ewma-lambda") == 0 && i + 1 < argc){
+            options.ewma_lambda = atof(argv[++i]);
+            if (!(options.ewma_lambda > 0 && options.ewma_lambda < 1)){
+                return 1;
+            }
+        }
+        else{
+            return 1; // Unknown switch
+        }
+    }
+    //A stream takes only its source, and the daemon and --append only one dataset. Otherwise the
+    //datasets come first and the asset type last, as before the switches existed; --snapshot and
+    //--all (or --assets) take datasets only (they cover every asset).
+    int single = options.stream || options.daemon || options.append_path;
+    int typed = !(single || options.snapshot_path || options.all);
+    if (single ? positional != 1 : positional < 1 + typed){
+        return 1;
+    }
+    if (typed){
+        *user_query = positionals[positional - 1];
+    }
+    for (int i = 0; i < positional - typed; i++){
+        glob_t matches;
+        //An existing name is taken literally; anything else is a pattern, kept as given when
+        //nothing matches so the open reports it. Matches come sorted, which fixes file order, and
+        //are kept for the life of the process.
+        int literal = single || access(positionals[i], F_OK) == 0
+                      || glob(positionals[i], GLOB_NOCHECK, NULL, &matches) != 0;
+        int added = literal ? 1 : (int)matches.gl_pathc;
+        char **grown = realloc(options.inputs, sizeof(char*) * (options.input_count + added));
+        if (grown == NULL){
+            return 1;
+        }
+        options.inputs = grown;
+        for (int j = 0; j < added; j++){
+            options.inputs[options.input_count++] = literal ? positionals[i] : matches.gl_pathv[j];
+        }
+    }
+    free(positionals);
+    *csv_path = options.inputs[0];
+    //Out-of-core runs keep no simulated samples and no loaded dataset to snapshot, and pass over one file.
+    if (options.out_of_core && (options.histogram || options.snapshot_path || options.daemon || options.stream
+                                || options.input_count > 1)){
+        return 1;
+    }
+    if (options.trace_id == NULL){
+        options.trace_id = getenv("ENGINE_TRACE_ID");
+    }
+    if (options.trace_id != NULL){
+        //The ID is echoed into JSON unescaped, so only token characters are accepted.
+        size_t length = strlen(options.trace_id);
+        if (length == 0 || length > 64 || strspn(options.trace_id,
+                "0123456789abcdefABCDEFghijklmnopqrstuvwxyzGHIJKLMNOPQRSTUVWXYZ-_") != length){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Reads the monotonic clock in nanoseconds.
+ * CLOCK_MONOTONIC is immune to NTP slews, so phase durations never go negative.
+ */
+static long long monotonic_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Reads the wall clock in nanoseconds since the epoch; used where stamps must line up
+ * with other processes (feed events, trace spans), never for durations.
+ */
+static long long realtime_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Reads the CPU timestamp counter where one exists (0 elsewhere).
+ * TSC deltas expose sub-microsecond phases that the clock rounds away.
+ */
+static unsigned long long read_tsc(void){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
     return 0;
+#endif
+}
+
+/**
+ * Marks the start of a phase.
+ * * @param id: The phase being entered.
+ */
+void phase_begin(PhaseId id){
+    if (!options.timings && !options.perf_counters && options.trace_id == NULL){
+        return;
+    }
+    if (perf_group.opened){
+        perf_read(perf_group.start[id]);
+    }
+    phase_timers[id].start_ns = monotonic_ns();
+    phase_timers[id].start_tsc = read_tsc();
+    if (!phase_timers[id].first_start_ns){
+        phase_timers[id].first_start_ns = phase_timers[id].start_ns;
+    }
+}
+
+/**
+ * Marks the end of a phase and accumulates its duration.
+ * * @param id: The phase being left (must match an earlier phase_begin).
+ */
+void phase_end(PhaseId id){
+    if (!options.timings && !options.perf_counters && options.trace_id == NULL){
+        return;
+    }
+    phase_timers[id].elapsed_ns += monotonic_ns() - phase_timers[id].start_ns;
+    phase_timers[id].elapsed_tsc += read_tsc() - phase_timers[id].start_tsc;
+    phase_timers[id].ran = 1;
+    //Counters are read last so the clock reads above are not charged to the next phase.
+    if (perf_group.opened){
+        unsigned long long now[PERF_EVENT_COUNT];
+        perf_read(now);
+        for (int e = 0; e < PERF_EVENT_COUNT; e++){
+            perf_group.total[id][e] += now[e] - perf_group.start[id][e];
+        }
+    }
+}
+
+/**
+ * Emits the timing report as a single JSON line on stderr.
+ * stdout stays reserved for the Python bridge, so the report never corrupts results.
+ * Phases that did not run (e.g. after an early error) are omitted.
+ * * @param exit_code: The code main() is about to return.
+ */
+void report_timings(int exit_code){
+    long long total_ns = 0;
+    double rows_per_sec = 0;
+    double samples_per_sec = 0;
+
+    //Only top-level phases count toward the total; sub-steps are nested inside them.
+    for (int i = 0; i < PHASE_COUNT; i++){
+        if (phase_timers[i].ran && strchr(phase_timers[i].name, '.') == NULL){
+            total_ns += phase_timers[i].elapsed_ns;
+        }
+    }
+    if (phase_timers[PHASE_INGESTION].elapsed_ns > 0){
+        rows_per_sec = rows_ingested / (phase_timers[PHASE_INGESTION].elapsed_ns / 1e9);
+    }
+    if (phase_timers[STEP_SIMULATION].elapsed_ns > 0){
+        samples_per_sec = samples_generated / (phase_timers[STEP_SIMULATION].elapsed_ns / 1e9);
+    }
+
+    fprintf(stderr, "{\"event\":\"timings\",\"exit_code\":%d,\"simd\":\"%s\",\"threads\":%d,\"rows\":%ld,\"samples\":%d,"
+            "\"total_ns\":%lld,\"rows_per_sec\":%.1f,\"samples_per_sec\":%.1f,\"phases\":{",
+            exit_code, kernels.name, pool.threads, rows_ingested, samples_generated, total_ns, rows_per_sec, samples_per_sec);
+    int first = 1;
+    for (int i = 0; i < PHASE_COUNT; i++){
+        if (!phase_timers[i].ran){
+            continue;
+        }
+        fprintf(stderr, "%s\"%s\":{\"ns\":%lld,\"tsc\":%llu}", first ? "" : ",",
+                phase_timers[i].name, phase_timers[i].elapsed_ns, phase_timers[i].elapsed_tsc);
+        first = 0;
+    }
+    fprintf(stderr, "}}\n");
+}
+
+/**
+ * Emits the phases as trace spans, one JSON line each on stderr, so the caller can
+ * place them in its request waterfall:
+ *   {"event":"span","trace_id":ID,"name":"engine.<phase>","parent":"engine"|"engine.<phase>",
+ *    "start_unix_ns":N,"duration_ns":N,"exit_code":N}
+ * Starts are converted from the monotonic clock to the wall clock (to line up with the
+ * caller's spans); durations stay monotonic. A phase that ran several times (one span per
+ * bucket in a batch) is reported once, from its first start, with its summed duration.
+ * * @param exit_code: The code main() is about to return.
+ */
+void report_spans(int exit_code){
+    long long wall_offset = realtime_ns() - monotonic_ns();
+
+    for (int i = 0; i < PHASE_COUNT; i++){
+        if (!phase_timers[i].ran){
+            continue;
+        }
+        //Sub-steps ("modeling.sort") nest under their phase; phases nest under the run.
+        const char *dot = strchr(phase_timers[i].name, '.');
+        int parent_length = dot ? (int)(dot - phase_timers[i].name) : 0;
+        fprintf(stderr, "{\"event\":\"span\",\"trace_id\":\"%s\",\"name\":\"engine.%s\",\"parent\":\"engine%s%.*s\","
+                "\"start_unix_ns\":%lld,\"duration_ns\":%lld,\"exit_code\":%d}\n",
+                options.trace_id, phase_timers[i].name, dot ? "." : "", parent_length, phase_timers[i].name,
+                phase_timers[i].first_start_ns + wall_offset, phase_timers[i].elapsed_ns, exit_code);
+    }
+}
+
+/**
+ * Funnels every exit of main() through the instrumentation.
+ * * @param exit_code: The process exit code (0 success, 1 I/O, 2 math, 3 lookup).
+ * @return: exit_code, unchanged.
+ */
+int engine_exit(int exit_code){
+    if (options.timings){
+        report_timings(exit_code);
+        if (pipeline_stages != NULL){
+            report_pipeline();
+        }
+        if (options.stream){
+            report_stream();
+        }
+    }
+    if (options.perf_counters){
+        report_perf_counters(exit_code);
+    }
+    if (options.trace_id != NULL){
+        report_spans(exit_code);
+    }
+    pool_shutdown();
+    return exit_code;
+}
+
+#ifdef __linux__
+/**
+ * Thin wrapper over the perf_event_open syscall (glibc ships no stub for it).
+ * Counts user space only so the default perf_event_paranoid level (2) permits it,
+ * and only the calling thread (pid 0, no inherit): pool workers are not counted.
+ * * @param config: PERF_COUNT_HW_* identifier of the event.
+ * @param group_fd: Leader descriptor, or -1 to create a new group.
+ * @return: The event descriptor, or -1 with errno set.
+ */
+static int perf_open_event(unsigned long long config, int group_fd){
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    //The leader starts disabled and is enabled once the whole group exists.
+    attr.disabled = (group_fd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+/**
+ * Opens cycles, instructions, LLC misses and branch misses as one counter group.
+ * Members the hardware lacks are skipped; if even the leader cannot be opened
+ * (containers, perf_event_paranoid=3, no PMU in the VM) the reason is recorded
+ * and the engine carries on uninstrumented.
+ */
+void perf_open(void){
+#ifdef __linux__
+    const unsigned long long configs[PERF_EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    int next_slot = 0;
+
+    for (int e = 0; e < PERF_EVENT_COUNT; e++){
+        perf_group.fds[e] = -1;
+        perf_group.slot[e] = -1;
+    }
+    perf_group.leader_fd = perf_open_event(configs[PERF_CYCLES], -1);
+    if (perf_group.leader_fd == -1){
+        perf_group.error = strerror(errno);
+        return;
+    }
+    perf_group.fds[PERF_CYCLES] = perf_group.leader_fd;
+    perf_group.slot[PERF_CYCLES] = next_slot++;
+    for (int e = PERF_CYCLES + 1; e < PERF_EVENT_COUNT; e++){
+        perf_group.fds[e] = perf_open_event(configs[e], perf_group.leader_fd);
+        if (perf_group.fds[e] != -1){
+            perf_group.slot[e] = next_slot++;
+        }
+    }
+    ioctl(perf_group.leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(perf_group.leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    perf_group.opened = 1;
+#else
+    perf_group.error = "perf_event_open is only available on Linux";
+#endif
+}
+
+/**
+ * Reads the whole group in one syscall so all members describe the same instant.
+ * When the kernel multiplexed the group off the PMU, values are scaled by
+ * time_enabled/time_running, as perf-stat does.
+ * * @param values: Receives one value per PerfEventId (0 for unopened members).
+ */
+void perf_read(unsigned long long values[PERF_EVENT_COUNT]){
+    //Layout for PERF_FORMAT_GROUP: nr, time_enabled, time_running, value[nr].
+    unsigned long long buffer[3 + PERF_EVENT_COUNT];
+
+    memset(values, 0, sizeof(unsigned long long) * PERF_EVENT_COUNT);
+#ifdef __linux__
+    if (read(perf_group.leader_fd, buffer, sizeof(buffer)) < (ssize_t)(sizeof(unsigned long long) * 3)){
+        return;
+    }
+    double scale = 1.0;
+    if (buffer[2] > 0 && buffer[2] < buffer[1]){
+        scale = (double)buffer[1] / buffer[2];
+    }
+    for (int e = 0; e < PERF_EVENT_COUNT; e++){
+        if (perf_group.slot[e] >= 0 && (unsigned long long)perf_group.slot[e] < buffer[0]){
+            values[e] = (unsigned long long)(buffer[3 + perf_group.slot[e]] * scale);
+        }
+    }
+#endif
+}
+
+/**
+ * Emits the per-phase hardware counters as a single JSON line on stderr.
+ * Members that could not be opened are reported as null rather than 0,
+ * so a missing PMU event is never mistaken for a perfect cache hit rate.
+ * * @param exit_code: The code main() is about to return.
+ */
+void report_perf_counters(int exit_code){
+    const char *names[PERF_EVENT_COUNT] = {"cycles", "instructions", "llc_misses", "branch_misses"};
+
+    if (!perf_group.opened){
+        fprintf(stderr, "{\"event\":\"perf_counters\",\"exit_code\":%d,\"available\":false,\"error\":\"%s\"}\n",
+                exit_code, perf_group.error ? perf_group.error : "unknown");
+        return;
+    }
+    //The counters follow the main thread alone; 'threads' says how many shared the work.
+    fprintf(stderr, "{\"event\":\"perf_counters\",\"exit_code\":%d,\"available\":true,"
+            "\"threads\":%d,\"counted_threads\":1,\"phases\":{", exit_code, pool.started ? pool.threads : 1);
+    int first = 1;
+    for (int i = 0; i < PHASE_COUNT; i++){
+        if (!phase_timers[i].ran){
+            continue;
+        }
+        fprintf(stderr, "%s\"%s\":{", first ? "" : ",", phase_timers[i].name);
+        for (int e = 0; e < PERF_EVENT_COUNT; e++){
+            if (perf_group.fds[e] == -1){
+                fprintf(stderr, "%s\"%s\":null", e ? "," : "", names[e]);
+            }
+            else{
+                fprintf(stderr, "%s\"%s\":%llu", e ? "," : "", names[e], perf_group.total[i][e]);
+            }
+        }
+        //Instructions per cycle is the first number anyone asks for, so derive it here.
+        if (perf_group.fds[PERF_INSTRUCTIONS] != -1 && perf_group.total[i][PERF_CYCLES] > 0){
+            fprintf(stderr, ",\"ipc\":%.3f",
+                    (double)perf_group.total[i][PERF_INSTRUCTIONS] / perf_group.total[i][PERF_CYCLES]);
+        }
+        fprintf(stderr, "}");
+        first = 0;
+    }
+    fprintf(stderr, "}}\n");
+}
+
+
+//Index of the pool worker running on this thread, -1 for threads outside the pool.
+static __thread int pool_worker = -1;
+
+//Busy-wait hint: frees the sibling hyperthread while a thread polls for work.
+static inline void cpu_relax(void){
+#ifdef SIMD_X86
+    _mm_pause();
+#endif
+}
+
+/**
+ * Owner-only push onto the bottom of a deque (Chase-Lev, C11 orderings after
+ * Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+ * * @return: 0 on success, 1 if the deque is full.
+ */
+static int deque_push(WorkDeque* deque, PoolTask* task){
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= POOL_DEQUE_SIZE){
+        return 1;
+    }
+    atomic_store_explicit(&deque->slots[bottom % POOL_DEQUE_SIZE], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return 0;
+}
+
+/**
+ * Owner-only take from the bottom (LIFO, so the owner stays on cache-warm work).
+ * Races a thief for the last task with a CAS on top.
+ */
+static PoolTask* deque_take(WorkDeque* deque){
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    PoolTask *task = NULL;
+
+    if (top <= bottom){
+        task = atomic_load_explicit(&deque->slots[bottom % POOL_DEQUE_SIZE], memory_order_relaxed);
+        if (top == bottom){
+            if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                         memory_order_seq_cst, memory_order_relaxed)){
+                task = NULL;
+            }
+            atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        }
+    }
+    else{
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+//Any-thread steal from the top (FIFO, so thieves get the biggest, oldest ranges).
+static PoolTask* deque_steal(WorkDeque* deque){
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top < bottom){
+        PoolTask *task = atomic_load_explicit(&deque->slots[top % POOL_DEQUE_SIZE], memory_order_relaxed);
+        if (atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                    memory_order_seq_cst, memory_order_relaxed)){
+            return task;
+        }
+    }
+    return NULL;
+}
+
+//Wakes one sleeping worker after work was queued.
+static void pool_notify(void){
+    if (atomic_load(&pool.sleepers) > 0){
+        pthread_mutex_lock(&pool.lock);
+        pthread_cond_signal(&pool.wake);
+        pthread_mutex_unlock(&pool.lock);
+    }
+}
+
+/**
+ * Makes a task visible to the pool: workers push onto their own deque, other
+ * threads append to the shared injection queue.
+ * * @return: 0 if queued, 1 if the caller must run the task itself (deque full or out of memory).
+ */
+static int pool_submit(PoolTask* task){
+    if (pool_worker >= 0){
+        if (deque_push(&pool.deques[pool_worker], task) != 0){
+            return 1;
+        }
+    }
+    else{
+        pthread_mutex_lock(&pool.lock);
+        if (pool.injected_head == pool.injected_count){
+            pool.injected_head = pool.injected_count = 0;
+        }
+        if (pool.injected_count == pool.injected_capacity){
+            int new_cap = pool.injected_capacity ? pool.injected_capacity * 2 : 64;
+            PoolTask **new_ptr = realloc(pool.injected, sizeof(PoolTask*) * new_cap);
+            if (new_ptr == NULL){
+                pthread_mutex_unlock(&pool.lock);
+                return 1;
+            }
+            pool.injected = new_ptr;
+            pool.injected_capacity = new_cap;
+        }
+        pool.injected[pool.injected_count++] = task;
+        pthread_mutex_unlock(&pool.lock);
+    }
+    atomic_fetch_add(&pool.queued, 1);
+    pool_notify();
+    return 0;
+}
+
+/**
+ * Finds the next task for this thread: its own deque first, then the injection
+ * queue, then a steal sweep over the other workers from a rotating start.
+ */
+static PoolTask* pool_find_task(unsigned* victim_seed){
+    PoolTask *task = NULL;
+    int workers = pool.threads - 1;
+
+    if (pool_worker >= 0 && (task = deque_take(&pool.deques[pool_worker])) != NULL){
+        return task;
+    }
+    if (atomic_load_explicit(&pool.queued, memory_order_relaxed) <= 0){
+        return NULL;
+    }
+    //FIFO, so concurrent requests are served in arrival order.
+    pthread_mutex_lock(&pool.lock);
+    if (pool.injected_head < pool.injected_count){
+        task = pool.injected[pool.injected_head++];
+    }
+    pthread_mutex_unlock(&pool.lock);
+    if (task != NULL || workers < 1){
+        return task;
+    }
+    *victim_seed = *victim_seed * 1103515245u + 12345u;
+    int start = (int)((*victim_seed >> 16) % (unsigned)workers);
+    for (int i = 0; i < workers; i++){
+        int victim = (start + i) % workers;
+        if (victim != pool_worker && (task = deque_steal(&pool.deques[victim])) != NULL){
+            return task;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Runs one task: keeps splitting off the upper half for thieves until the range
+ * is at most one grain, then runs the body on what is left.
+ */
+static void pool_execute(PoolTask* task){
+    while (task->end - task->begin > task->grain){
+        long middle = task->begin + (task->end - task->begin) / 2;
+        PoolTask *upper = malloc(sizeof(PoolTask));
+        if (upper == NULL){
+            break;
+        }
+        *upper = *task;
+        upper->begin = middle;
+        atomic_fetch_add(&task->group->pending, 1);
+        if (pool_submit(upper) != 0){
+            //No room to share it: run the upper half here instead.
+            pool_execute(upper);
+        }
+        task->end = middle;
+    }
+    task->body(task->arg, task->begin, task->end);
+    atomic_fetch_sub_explicit(&task->group->pending, 1, memory_order_release);
+    free(task);
+}
+
+/**
+ * Worker main loop: run whatever can be found, spin briefly, then sleep until a
+ * submit signals that work was queued.
+ */
+static void* pool_worker_main(void* arg){
+    unsigned victim_seed = (unsigned)(long)arg * 2654435761u + 1;
+    pool_worker = (int)(long)arg;
+
+    while (!atomic_load(&pool.shutdown)){
+        PoolTask *task = pool_find_task(&victim_seed);
+        if (task != NULL){
+            atomic_fetch_sub(&pool.queued, 1);
+            pool_execute(task);
+            continue;
+        }
+        int spins = 0;
+        while (atomic_load(&pool.queued) <= 0 && !atomic_load(&pool.shutdown) && spins++ < 2000){
+            cpu_relax();
+        }
+        if (atomic_load(&pool.queued) > 0){
+            continue;
+        }
+        //Registering as a sleeper before re-checking 'queued' closes the lost-wakeup window.
+        pthread_mutex_lock(&pool.lock);
+        atomic_fetch_add(&pool.sleepers, 1);
+        while (atomic_load(&pool.queued) <= 0 && !atomic_load(&pool.shutdown)){
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        }
+        atomic_fetch_sub(&pool.sleepers, 1);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    return NULL;
+}
+
+/**
+ * Records the pool size and pinning policy.
+ * * @param threads: Threads sharing parallel work including the caller; 0 reads
+ * ENGINE_THREADS, and failing that uses every CPU this process may run on.
+ * @param pin: 1 to pin workers (ENGINE_PIN=1 also enables it).
+ */
+void pool_configure(int threads, int pin){
+    const char *env_threads = getenv("ENGINE_THREADS");
+    const char *env_pin = getenv("ENGINE_PIN");
+    cpu_set_t allowed;
+
+    if (threads <= 0 && env_threads != NULL){
+        threads = atoi(env_threads);
+    }
+    if (threads <= 0){
+        threads = (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) ? CPU_COUNT(&allowed) : 1;
+    }
+    if (threads > POOL_MAX_THREADS){
+        threads = POOL_MAX_THREADS;
+    }
+    pool.threads = threads;
+    pool.pin = pin || (env_pin != NULL && strcmp(env_pin, "1") == 0);
+}
+
+/**
+ * Creates the deques and workers. Worker i is pinned to the (i+1)-th allowed CPU
+ * when pinning is on, leaving the first one for the thread that called us.
+ */
+static void pool_start(void){
+    int workers = pool.threads - 1;
+    cpu_set_t allowed;
+    int cpus[CPU_SETSIZE];
+    int cpu_count = 0;
+
+    pool.deques = aligned_alloc(64, sizeof(WorkDeque) * workers);
+    pool.workers = malloc(sizeof(pthread_t) * workers);
+    if (pool.deques == NULL || pool.workers == NULL){
+        free(pool.deques);
+        free(pool.workers);
+        pool.threads = 1;
+        return;
+    }
+    memset(pool.deques, 0, sizeof(WorkDeque) * workers);
+    if (pool.pin && sched_getaffinity(0, sizeof(allowed), &allowed) == 0){
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+            if (CPU_ISSET(cpu, &allowed)){
+                cpus[cpu_count++] = cpu;
+            }
+        }
+    }
+    for (int i = 0; i < workers; i++){
+        if (pthread_create(&pool.workers[i], NULL, pool_worker_main, (void*)(long)i) != 0){
+            //Run with however many workers did start.
+            pool.threads = i + 1;
+            break;
+        }
+        if (cpu_count > 0){
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpus[(i + 1) % cpu_count], &one);
+            pthread_setaffinity_np(pool.workers[i], sizeof(one), &one);
+        }
+    }
+    pool.started = 1;
+}
+
+void parallel_for(long count, long grain, RangeBody body, void* arg){
+    static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+    unsigned victim_seed = (unsigned)(size_t)&victim_seed;
+
+    if (grain < 1){
+        grain = 1;
+    }
+    //One grain, or one thread: no scheduling at all.
+    if (count <= grain || pool.threads < 2){
+        if (count > 0){
+            body(arg, 0, count);
+        }
+        return;
+    }
+    pthread_once(&start_once, pool_start);
+    if (pool.threads < 2){
+        body(arg, 0, count);
+        return;
+    }
+
+    TaskGroup group;
+    atomic_init(&group.pending, 1);
+    PoolTask *root = malloc(sizeof(PoolTask));
+    if (root == NULL){
+        body(arg, 0, count);
+        return;
+    }
+    *root = (PoolTask){body, arg, 0, count, grain, &group};
+    pool_execute(root);
+
+    //Help instead of blocking: the waiting thread runs queued tasks until its group drains.
+    while (atomic_load_explicit(&group.pending, memory_order_acquire) > 0){
+        PoolTask *task = pool_find_task(&victim_seed);
+        if (task != NULL){
+            atomic_fetch_sub(&pool.queued, 1);
+            pool_execute(task);
+        }
+        else{
+            cpu_relax();
+        }
+    }
+}
+
+//Arguments of one parallel_reduce, shared by its chunk tasks.
+typedef struct {
+    double (*body)(void* arg, long begin, long end);
+    void *arg;
+    long count;
+    long grain;
+    double *partials;
+} ReduceJob;
+
+static void reduce_chunks(void* arg, long begin, long end){
+    ReduceJob *job = arg;
+    for (long chunk = begin; chunk < end; chunk++){
+        long first = chunk * job->grain;
+        long last = first + job->grain < job->count ? first + job->grain : job->count;
+        job->partials[chunk] = job->body(job->arg, first, last);
+    }
+}
+
+double parallel_reduce(long count, long grain, double (*body)(void* arg, long begin, long end), void* arg){
+    long chunks = (count + grain - 1) / grain;
+    double total = 0;
+
+    if (chunks <= 1){
+        return count > 0 ? body(arg, 0, count) : 0;
+    }
+    ReduceJob job = {body, arg, count, grain, malloc(sizeof(double) * chunks)};
+    if (job.partials == NULL){
+        return body(arg, 0, count);
+    }
+    parallel_for(chunks, 1, reduce_chunks, &job);
+    //Fixed chunk boundaries and a fixed summation order keep the result reproducible.
+    for (long chunk = 0; chunk < chunks; chunk++){
+        total += job.partials[chunk];
+    }
+    free(job.partials);
+    return total;
+}
+
+void pool_shutdown(void){
+    if (!pool.started){
+        return;
+    }
+    pthread_mutex_lock(&pool.lock);
+    atomic_store(&pool.shutdown, 1);
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+    for (int i = 0; i < pool.threads - 1; i++){
+        pthread_join(pool.workers[i], NULL);
+    }
+    free(pool.workers);
+    free(pool.deques);
+    free(pool.injected);
+    pool.started = 0;
+}
+
+void moments_merge(Moments* into, long count, double mean, double m2){
+    if (count == 0){
+        return;
+    }
+    long total = into->count + count;
+    double delta = mean - into->mean;
+    into->mean += delta * count / total;
+    into->m2 += m2 + delta * delta * ((double)into->count * count / total);
+    into->count = total;
+}
+
+/**
+ * Producer side: waits for a free slot and returns it for filling.
+ * Waiting spins briefly, then yields, so an oversubscribed machine still makes progress.
+ * * @param stall_ns: Receives the time spent waiting (accumulated).
+ */
+static void* spsc_claim(SpscRing* ring, long long* stall_ns){
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= PIPELINE_RING_SLOTS){
+        long long start = monotonic_ns();
+        for (int spins = 0; head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= PIPELINE_RING_SLOTS; spins++){
+            if (spins < 64) cpu_relax(); else sched_yield();
+        }
+        *stall_ns += monotonic_ns() - start;
+    }
+    return ring->slots[head % PIPELINE_RING_SLOTS];
+}
+
+static void spsc_publish(SpscRing* ring){
+    atomic_store_explicit(&ring->head, atomic_load_explicit(&ring->head, memory_order_relaxed) + 1, memory_order_release);
+}
+
+//Consumer side: waits for a published slot and returns it without removing it.
+static void* spsc_peek(SpscRing* ring, long long* stall_ns){
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (atomic_load_explicit(&ring->head, memory_order_acquire) == tail){
+        long long start = monotonic_ns();
+        for (int spins = 0; atomic_load_explicit(&ring->head, memory_order_acquire) == tail; spins++){
+            if (spins < 64) cpu_relax(); else sched_yield();
+        }
+        *stall_ns += monotonic_ns() - start;
+    }
+    return ring->slots[tail % PIPELINE_RING_SLOTS];
+}
+
+static void spsc_release(SpscRing* ring){
+    atomic_store_explicit(&ring->tail, atomic_load_explicit(&ring->tail, memory_order_relaxed) + 1, memory_order_release);
+}
+
+//Everything the stage threads share: rings, sizes and the failure flag.
+typedef struct {
+    int parsers;
+    int accumulators;
+    //One ring per parser, then parsers x accumulators rings of batches.
+    SpscRing *blocks;
+    SpscRing *batches;
+    StageCounters *counters;
+    atomic_int failed;
+} Pipeline;
+
+//Arguments of one stage thread; a parser also tracks the batch it is filling per accumulator.
+typedef struct {
+    Pipeline *pipeline;
+    int id;
+    PipelineBatch *open[TABLE_SIZE];
+} StageArg;
+
+//Parser emit target: routes a row to the batch of the accumulator owning its bucket.
+static int emit_batch(RawData* entry, void* context){
+    StageArg *self = context;
+    int index = hash(entry->type);
+    PipelineBatch *batch = self->open[index % self->pipeline->accumulators];
+
+    if (batch->count == batch->capacity){
+        size_t new_cap = batch->capacity ? batch->capacity * 2 : 4096;
+        unsigned char *ids = realloc(batch->ids, new_cap);
+        float *values = realloc(batch->values, sizeof(float) * new_cap);
+        if (ids != NULL) batch->ids = ids;
+        if (values != NULL) batch->values = values;
+        if (ids == NULL || values == NULL) return 1;
+        batch->capacity = new_cap;
+    }
+    //The first name per bucket in this block is the one a sequential ingest would have used.
+    if (!(batch->present & (1u << index))){
+        batch->present |= 1u << index;
+        strcpy(batch->names[index], entry->type);
+    }
+    batch->ids[batch->count] = (unsigned char)index;
+    batch->values[batch->count] = entry->value;
+    batch->count++;
+    return 0;
+}
+
+/**
+ * Parser stage: turns each raw block into one batch per accumulator, in block order.
+ */
+static void* pipeline_parser(void* arg){
+    StageArg *self = arg;
+    Pipeline *pipe = self->pipeline;
+    StageCounters *counters = &pipe->counters[1 + self->id];
+    SpscRing *input = &pipe->blocks[self->id];
+    SpscRing *outputs = &pipe->batches[self->id * pipe->accumulators];
+    uint64_t *commas = NULL;
+    uint64_t *newlines = NULL;
+    size_t mask_words = 0;
+
+    for (;;){
+        PipelineBlock *block = spsc_peek(input, &counters->stall_ns);
+        long long start = monotonic_ns();
+        for (int a = 0; a < pipe->accumulators; a++){
+            PipelineBatch *batch = spsc_claim(&outputs[a], &counters->stall_ns);
+            batch->count = 0;
+            batch->present = 0;
+            batch->end = block->end;
+            self->open[a] = batch;
+        }
+        if (!block->end){
+            size_t consumed;
+            if (block->length / 64 + 1 > mask_words){
+                mask_words = block->length / 64 + 1;
+                free(commas);
+                free(newlines);
+                commas = malloc(sizeof(uint64_t) * mask_words);
+                newlines = malloc(sizeof(uint64_t) * mask_words);
+            }
+            if (commas == NULL || newlines == NULL
+                || parse_block(block->data, block->length, 1, commas, newlines, emit_batch, self, &consumed) != 0){
+                atomic_store(&pipe->failed, 1);
+                mask_words = 0;
+            }
+            counters->blocks++;
+            counters->bytes += block->length;
+        }
+        int end = block->end;
+        spsc_release(input);
+        for (int a = 0; a < pipe->accumulators; a++){
+            counters->rows += self->open[a]->count;
+            spsc_publish(&outputs[a]);
+        }
+        counters->busy_ns += monotonic_ns() - start;
+        if (end){
+            break;
+        }
+    }
+    free(commas);
+    free(newlines);
+    return NULL;
+}
+
+/**
+ * Accumulator stage: appends its buckets' rows in file order and folds each
+ * block's contribution into the bucket's running moments.
+ */
+static void* pipeline_accumulator(void* arg){
+    StageArg *self = arg;
+    Pipeline *pipe = self->pipeline;
+    StageCounters *counters = &pipe->counters[1 + pipe->parsers + self->id];
+
+    for (long block = 0;; block++){
+        SpscRing *input = &pipe->batches[(block % pipe->parsers) * pipe->accumulators + self->id];
+        PipelineBatch *batch = spsc_peek(input, &counters->stall_ns);
+        long long start = monotonic_ns();
+        int first[TABLE_SIZE];
+
+        if (batch->end){
+            spsc_release(input);
+            break;
+        }
+        for (int index = 0; index < TABLE_SIZE; index++){
+            first[index] = -1;
+            if (batch->present & (1u << index)){
+                if (buckets[index] == NULL && (buckets[index] = create_bucket(batch->names[index])) == NULL){
+                    atomic_store(&pipe->failed, 1);
+                    continue;
+                }
+                first[index] = buckets[index]->day_count;
+            }
+        }
+        for (size_t i = 0; i < batch->count; i++){
+            Portfolio *bucket = buckets[batch->ids[i]];
+            if (bucket == NULL){
+                continue;
+            }
+            if (bucket->day_count >= bucket->capacity){
+                float *new_ptr = realloc(bucket->returns, sizeof(float) * bucket->capacity * 2);
+                if (new_ptr == NULL){
+                    atomic_store(&pipe->failed, 1);
+                    continue;
+                }
+                bucket->returns = new_ptr;
+                bucket->capacity *= 2;
+            }
+            bucket->returns[bucket->day_count++] = batch->values[i];
+        }
+        //Each bucket's new rows are contiguous, so the block's moments come from the vector kernels.
+        for (int index = 0; index < TABLE_SIZE; index++){
+            if (first[index] < 0){
+                continue;
+            }
+            float *segment = buckets[index]->returns + first[index];
+            int count = buckets[index]->day_count - first[index];
+            double segment_mean = kernels.sum(segment, count) / count;
+            double segment_m2 = kernels.sum_sq_dev(segment, count, segment_mean);
+            moments_merge(&ingest_moments[index], count, segment_mean, segment_m2);
+        }
+        counters->blocks++;
+        counters->rows += batch->count;
+        spsc_release(input);
+        counters->busy_ns += monotonic_ns() - start;
+    }
+    return NULL;
+}
+
+/**
+ * Pipelined ingestion. The calling thread is the reader: it fills raw blocks cut
+ * at the last newline (carrying the partial line forward) and deals them to the
+ * parsers round-robin. Parser p hands accumulator a its rows through ring (p, a),
+ * and accumulator a reads block b from parser b % P, so every bucket receives its
+ * rows in file order, exactly as ingest_stream() stores them.
+ *
+ * Stage threads are dedicated rather than pool tasks: they block on rings for the
+ * whole read, and running them on the pool could starve it (or deadlock when the
+ * stages outnumber the workers). Half the remaining threads parse, the rest
+ * accumulate, with at least one of each.
+ * * @param input: An open CSV stream.
+ * @return: 0 on success, 1 on allocation or thread failure.
+ */
+int ingest_pipeline(FILE* input){
+    Pipeline pipe = {0};
+    int helpers = pool.threads - 1;
+    pipe.parsers = (helpers + 1) / 2 > 0 ? (helpers + 1) / 2 : 1;
+    pipe.accumulators = helpers - pipe.parsers > 0 ? helpers - pipe.parsers : 1;
+    if (pipe.accumulators > TABLE_SIZE){
+        pipe.accumulators = TABLE_SIZE;
+    }
+    int stage_count = 1 + pipe.parsers + pipe.accumulators;
+    int ring_count = pipe.parsers + pipe.parsers * pipe.accumulators;
+    int status = 0;
+
+    SpscRing *rings = aligned_alloc(64, sizeof(SpscRing) * ring_count);
+    PipelineBlock *blocks = calloc(pipe.parsers * PIPELINE_RING_SLOTS, sizeof(PipelineBlock));
+    PipelineBatch *batches = calloc(pipe.parsers * pipe.accumulators * PIPELINE_RING_SLOTS, sizeof(PipelineBatch));
+    StageArg *args = malloc(sizeof(StageArg) * stage_count);
+    pthread_t *threads = malloc(sizeof(pthread_t) * stage_count);
+    char *carry = NULL;
+    size_t carry_length = 0;
+    pipe.counters = calloc(stage_count, sizeof(StageCounters));
+    if (rings == NULL || blocks == NULL || batches == NULL || args == NULL || threads == NULL || pipe.counters == NULL){
+        status = 1;
+        goto done;
+    }
+    memset(rings, 0, sizeof(SpscRing) * ring_count);
+    pipe.blocks = rings;
+    pipe.batches = rings + pipe.parsers;
+    for (int r = 0; r < pipe.parsers; r++){
+        for (int slot = 0; slot < PIPELINE_RING_SLOTS; slot++){
+            pipe.blocks[r].slots[slot] = &blocks[r * PIPELINE_RING_SLOTS + slot];
+        }
+    }
+    for (int r = 0; r < pipe.parsers * pipe.accumulators; r++){
+        for (int slot = 0; slot < PIPELINE_RING_SLOTS; slot++){
+            pipe.batches[r].slots[slot] = &batches[r * PIPELINE_RING_SLOTS + slot];
+        }
+    }
+    memset(ingest_moments, 0, sizeof(ingest_moments));
+    pipe.counters[0] = (StageCounters){"reader", 0};
+
+    //Accumulators first: a parser that exists always has somewhere to send its end marker.
+    int started = 0;
+    for (int a = 0; a < pipe.accumulators && status == 0; a++){
+        args[1 + pipe.parsers + a] = (StageArg){&pipe, a, {NULL}};
+        pipe.counters[1 + pipe.parsers + a] = (StageCounters){"accumulator", a};
+        if (pthread_create(&threads[1 + pipe.parsers + a], NULL, pipeline_accumulator, &args[1 + pipe.parsers + a]) != 0){
+            //Already-running accumulators stop at the end markers sent below.
+            pipe.accumulators = a;
+            status = 1;
+        }
+    }
+    for (int p = 0; p < pipe.parsers && status == 0; p++){
+        args[1 + p] = (StageArg){&pipe, p, {NULL}};
+        pipe.counters[1 + p] = (StageCounters){"parser", p};
+        if (pthread_create(&threads[1 + p], NULL, pipeline_parser, &args[1 + p]) != 0){
+            status = 1;
+            break;
+        }
+        started++;
+    }
+
+    long block_number = 0;
+    StageCounters *reader = &pipe.counters[0];
+    while (status == 0){
+        PipelineBlock *block = spsc_claim(&pipe.blocks[block_number % pipe.parsers], &reader->stall_ns);
+        long long start = monotonic_ns();
+        if (block->capacity < carry_length + READ_BLOCK){
+            char *grown = realloc(block->data, carry_length + READ_BLOCK);
+            if (grown == NULL){
+                status = 1;
+                break;
+            }
+            block->data = grown;
+            block->capacity = carry_length + READ_BLOCK;
+        }
+        memcpy(block->data, carry, carry_length);
+        size_t got = fread(block->data + carry_length, 1, READ_BLOCK, input);
+        size_t filled = carry_length + got;
+        reader->bytes += got;
+        reader->busy_ns += monotonic_ns() - start;
+        if (got == 0){
+            //End of input: whatever is carried is a final line without a newline.
+            if (filled == 0){
+                break;
+            }
+            block->length = filled;
+            carry_length = 0;
+        }
+        else{
+            char *last_newline = memrchr(block->data, '\n', filled);
+            size_t cut = last_newline != NULL ? (size_t)(last_newline - block->data) + 1 : 0;
+            char *grown = realloc(carry, filled - cut + 1);
+            if (grown == NULL){
+                status = 1;
+                break;
+            }
+            carry = grown;
+            memcpy(carry, block->data + cut, filled - cut);
+            carry_length = filled - cut;
+            //A line longer than the block: keep reading into the carry before handing anything off.
+            if (cut == 0){
+                continue;
+            }
+            block->length = cut;
+        }
+        block->end = 0;
+        spsc_publish(&pipe.blocks[block_number % pipe.parsers]);
+        reader->blocks++;
+        block_number++;
+        if (got == 0){
+            break;
+        }
+    }
+
+    //End markers continue the round-robin, so every parser (and through it every accumulator) stops in order.
+    for (int k = 0; k < pipe.parsers; k++){
+        int parser = (int)((block_number + k) % pipe.parsers);
+        if (parser < started){
+            PipelineBlock *block = spsc_claim(&pipe.blocks[parser], &reader->stall_ns);
+            block->end = 1;
+            spsc_publish(&pipe.blocks[parser]);
+        }
+        else{
+            //A parser that never started: stand in for it and end its accumulator rings directly.
+            for (int a = 0; a < pipe.accumulators; a++){
+                PipelineBatch *batch = spsc_claim(&pipe.batches[parser * pipe.accumulators + a], &reader->stall_ns);
+                batch->count = 0;
+                batch->present = 0;
+                batch->end = 1;
+                spsc_publish(&pipe.batches[parser * pipe.accumulators + a]);
+            }
+        }
+    }
+    for (int p = 0; p < started; p++){
+        pthread_join(threads[1 + p], NULL);
+    }
+    for (int a = 0; a < pipe.accumulators; a++){
+        pthread_join(threads[1 + pipe.parsers + a], NULL);
+        rows_ingested += pipe.counters[1 + pipe.parsers + a].rows;
+    }
+    if (atomic_load(&pipe.failed)){
+        status = 1;
+    }
+
+done:
+    free(pipeline_stages);
+    pipeline_stages = pipe.counters;
+    pipeline_stage_count = stage_count;
+    if (blocks != NULL){
+        for (int i = 0; i < pipe.parsers * PIPELINE_RING_SLOTS; i++){
+            free(blocks[i].data);
+        }
+    }
+    if (batches != NULL){
+        for (int i = 0; i < pipe.parsers * pipe.accumulators * PIPELINE_RING_SLOTS; i++){
+            free(batches[i].ids);
+            free(batches[i].values);
+        }
+    }
+    free(rings);
+    free(blocks);
+    free(batches);
+    free(args);
+    free(threads);
+    free(carry);
+    return status;
+}
+
+void report_pipeline(void){
+    fprintf(stderr, "{\"event\":\"pipeline\",\"stages\":[");
+    for (int i = 0; i < pipeline_stage_count; i++){
+        StageCounters *stage = &pipeline_stages[i];
+        double seconds = (stage->busy_ns + stage->stall_ns) / 1e9;
+        fprintf(stderr, "%s{\"stage\":\"%s\",\"id\":%d,\"blocks\":%ld,\"rows\":%ld,\"bytes\":%zu,"
+                "\"busy_ns\":%lld,\"stall_ns\":%lld,\"rows_per_sec\":%.1f,\"mb_per_sec\":%.1f}",
+                i ? "," : "", stage->stage, stage->id, stage->blocks, stage->rows, stage->bytes,
+                stage->busy_ns, stage->stall_ns,
+                seconds > 0 ? stage->rows / seconds : 0, seconds > 0 ? stage->bytes / seconds / 1e6 : 0);
+    }
+    fprintf(stderr, "]}\n");
+}
+
+void sketch_add(QuantileSketch* sketch, double value){
+    double magnitude = fabs(value);
+    if (magnitude < SKETCH_MIN_VALUE){
+        sketch->zero++;
+    }
+    else{
+        //Bin i holds magnitudes in (MIN * gamma^(i-1), MIN * gamma^i], gamma = (1 + alpha) / (1 - alpha).
+        double index = ceil(log(magnitude / SKETCH_MIN_VALUE) / log((1 + SKETCH_ALPHA) / (1 - SKETCH_ALPHA)));
+        int bin = index < SKETCH_BINS ? (int)index : SKETCH_BINS - 1;
+        if (value < 0){
+            sketch->negative[bin]++;
+        }
+        else{
+            sketch->positive[bin]++;
+        }
+    }
+    sketch->count++;
+}
+
+/**
+ * Walks the bins in ascending value order to the requested rank.
+ * Each bin answers with the point whose relative distance to both of its edges is SKETCH_ALPHA.
+ * * @param q: Quantile in [0, 1] (VAR_LEVEL for Value at Risk).
+ * @return: The estimated quantile, 0 for an empty sketch.
+ */
+double sketch_quantile(const QuantileSketch* sketch, double q){
+    double gamma = (1 + SKETCH_ALPHA) / (1 - SKETCH_ALPHA);
+    uint64_t rank;
+    uint64_t seen = 0;
+
+    if (sketch->count == 0){
+        return 0;
+    }
+    rank = (uint64_t)(q * (sketch->count - 1));
+    //Largest losses first, then the zero bin, then gains.
+    for (int i = SKETCH_BINS - 1; i >= 0; i--){
+        seen += sketch->negative[i];
+        if (seen > rank){
+            return -SKETCH_MIN_VALUE * 2 * pow(gamma, i) / (gamma + 1);
+        }
+    }
+    seen += sketch->zero;
+    if (seen > rank){
+        return 0;
+    }
+    for (int i = 0; i < SKETCH_BINS; i++){
+        seen += sketch->positive[i];
+        if (seen > rank){
+            return SKETCH_MIN_VALUE * 2 * pow(gamma, i) / (gamma + 1);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Finds (or creates) the symbol's state and folds one value into it.
+ * Every update is O(1): a Welford step, one EWMA step and one sketch increment.
+ * * @param symbol: The symbol bytes (not necessarily terminated). Matched case-insensitively,
+ * as hash() does for the batch path; the symbol keeps the spelling it was first seen in.
+ * @param length: Number of symbol bytes; longer names are truncated to 19 like the batch path.
+ * @param value: A return, or a price with --prices.
+ * @param timestamp: Event time as sent by the feed (receipt time when it sent none).
+ * @return: 0 if applied, 1 if rejected (empty name, non-finite value, bad price, table full).
+ */
+int stream_event(const char* symbol, size_t length, double value, long long timestamp){
+    StreamAsset *asset;
+    double change = value;
+
+    //Prices must be positive; a rejected event leaves the symbol (and its last_ts) alone.
+    if (length == 0 || !isfinite(value) || (options.prices && !(value > 0))){
+        stream_stats.rejected++;
+        return 1;
+    }
+    if (length > sizeof(asset->name) - 1){
+        length = sizeof(asset->name) - 1;
+    }
+    //FNV-1a over the uppercased name picks the home slot; collisions probe linearly.
+    uint32_t hash_value = 2166136261u;
+    for (size_t i = 0; i < length; i++){
+        hash_value = (hash_value ^ (unsigned char)toupper((unsigned char)symbol[i])) * 16777619u;
+    }
+    size_t slot = hash_value & (STREAM_MAX_ASSETS - 1);
+    while ((asset = stream_assets[slot]) != NULL
+           && (strncasecmp(asset->name, symbol, length) != 0 || asset->name[length] != '\0')){
+        slot = (slot + 1) & (STREAM_MAX_ASSETS - 1);
+    }
+    if (asset == NULL){
+        //Stopping at three-quarters full keeps probe runs short; later new symbols are dropped.
+        if (stream_stats.assets >= STREAM_MAX_ASSETS / 4 * 3 || (asset = calloc(1, sizeof(StreamAsset))) == NULL){
+            stream_stats.rejected++;
+            return 1;
+        }
+        memcpy(asset->name, symbol, length);
+        stream_assets[slot] = asset;
+        stream_order[stream_stats.assets++] = asset;
+    }
+
+    stream_stats.events++;
+    asset->last_ts = timestamp;
+    if (options.prices){
+        double previous = asset->last_price;
+        asset->last_price = value;
+        //The first price only anchors the next return.
+        if (previous == 0){
+            return 0;
+        }
+        change = value / previous - 1;
+    }
+    //RiskMetrics recursion around a zero mean, seeded with the first squared return.
+    if (asset->moments.count == 0){
+        asset->ewma_var = change * change;
+    }
+    else{
+        asset->ewma_var = options.ewma_lambda * asset->ewma_var + (1 - options.ewma_lambda) * change * change;
+    }
+    moments_merge(&asset->moments, 1, change, 0);
+    sketch_add(&asset->sketch, change);
+    asset->dirty = 1;
+    return 0;
+}
+
+//Event count and clock reading at the last publish, for the two cadences.
+static long stream_published_events;
+static long long stream_published_ns;
+//Set by SIGINT/SIGTERM; the long-running modes (stream, daemon) finish their current step and return.
+static volatile sig_atomic_t engine_stop;
+
+static void engine_signal(int signo){
+    (void)signo;
+    engine_stop = 1;
+}
+
+//No SA_RESTART: the signal must interrupt a blocking poll(), accept() or nanosleep().
+static void install_stop_handlers(void){
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = engine_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
+
+//Symbols come from the feed, so quotes, backslashes and control bytes are escaped.
+static void print_json_string(const char* text){
+    putchar('"');
+    for (const unsigned char *p = (const unsigned char*)text; *p; p++){
+        if (*p == '"' || *p == '\\'){
+            printf("\\%c", *p);
+        }
+        else if (*p < 0x20){
+            printf("\\u%04x", *p);
+        }
+        else{
+            putchar(*p);
+        }
+    }
+    putchar('"');
+}
+
+/**
+ * Publishes the assets that changed since the last publish, then flushes stdout so a
+ * reader on a pipe sees the line at once. Nothing is written when nothing changed.
+ */
+void stream_publish(void){
+    long long start = monotonic_ns();
+    int written = 0;
+
+    stream_published_events = stream_stats.events;
+    stream_published_ns = start;
+    for (int i = 0; i < stream_stats.assets; i++){
+        StreamAsset *asset = stream_order[i];
+        if (!asset->dirty){
+            continue;
+        }
+        asset->dirty = 0;
+        Moments *moments = &asset->moments;
+        double sdev = moments->count > 1 ? sqrt(moments->m2 / (moments->count - 1)) : 0;
+        double ewma_vol = sqrt(asset->ewma_var);
+        if (written == 0){
+            printf("{\"event\":\"var\",\"seq\":%ld,\"events\":%ld,\"assets\":[",
+                   stream_stats.publishes + 1, stream_stats.events);
+        }
+        printf("%s{\"symbol\":", written ? "," : "");
+        print_json_string(asset->name);
+        printf(",\"count\":%ld,\"timestamp\":%lld,\"mean\":%.8f,\"std_dev\":%.8f,\"ewma_vol\":%.8f,"
+               "\"var_normal\":%.8f,\"var_ewma\":%.8f,\"var_sketch\":%.8f}",
+               moments->count, asset->last_ts, moments->mean, sdev, ewma_vol,
+               moments->mean + Z_VAR_LEVEL * sdev, Z_VAR_LEVEL * ewma_vol,
+               sketch_quantile(&asset->sketch, VAR_LEVEL));
+        written++;
+    }
+    if (written == 0){
+        return;
+    }
+    printf("]}\n");
+    fflush(stdout);
+    stream_stats.publishes++;
+    long long spent = monotonic_ns() - start;
+    if (spent > stream_stats.max_publish_ns){
+        stream_stats.max_publish_ns = spent;
+    }
+}
+
+static inline void stream_count_cadence(void){
+    if (options.publish_every > 0 && stream_stats.events - stream_published_events >= options.publish_every){
+        stream_publish();
+    }
+}
+
+/**
+ * Applies one text event: SYMBOL,value[,timestamp].
+ * Blank lines are skipped; a value field that does not start like a number is rejected
+ * rather than read as 0, since one bogus zero would skew a live feed's state for good.
+ * * @param line: First byte of the line.
+ * @param end: One past the last byte (the '\n' or end of input).
+ * @param received_ns: Wall-clock receipt time, used when the line has no timestamp.
+ */
+static void stream_line(const char* line, const char* end, long long received_ns){
+    const char *comma = memchr(line, ',', end - line);
+    if (comma == NULL){
+        if (end > line && !(end - line == 1 && *line == '\r')){
+            stream_stats.rejected++;
+        }
+        return;
+    }
+    const char *value_end = memchr(comma + 1, ',', end - comma - 1);
+    long long timestamp = received_ns;
+    if (value_end != NULL){
+        const char *p = value_end + 1;
+        int negative = (p < end && *p == '-');
+        long long parsed = 0;
+        p += negative;
+        if (p < end && *p >= '0' && *p <= '9'){
+            while (p < end && *p >= '0' && *p <= '9'){
+                parsed = parsed * 10 + (*p++ - '0');
+            }
+            timestamp = negative ? -parsed : parsed;
+        }
+    }
+    else{
+        value_end = end;
+    }
+    const char *p = comma + 1;
+    while (p < value_end && (*p == ' ' || *p == '\t')){
+        p++;
+    }
+    if (p == value_end || !((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == '.')){
+        stream_stats.rejected++;
+        return;
+    }
+    stream_event(line, comma - line, parse_decimal(comma + 1, value_end), timestamp);
+}
+
+/**
+ * Applies every complete event in a buffer.
+ * * @return: Bytes consumed; the rest is a partial line or record to carry over.
+ */
+static size_t stream_apply(const char* buffer, size_t length, long long received_ns){
+    if (options.binary){
+        size_t used = length - length % sizeof(StreamTick);
+        for (size_t offset = 0; offset < used; offset += sizeof(StreamTick)){
+            StreamTick tick;
+            memcpy(&tick, buffer + offset, sizeof(tick));
+            stream_event(tick.symbol, strnlen(tick.symbol, sizeof(tick.symbol)), tick.value, tick.timestamp_ns);
+            stream_count_cadence();
+        }
+        return used;
+    }
+    const char *line = buffer;
+    const char *newline;
+    while ((newline = memchr(line, '\n', buffer + length - line)) != NULL){
+        stream_line(line, newline, received_ns);
+        stream_count_cadence();
+        line = newline + 1;
+    }
+    return line - buffer;
+}
+
+/**
+ * Consumes one feed descriptor until EOF, an error or a stop signal.
+ * Events are applied as soon as read() returns them, whatever the read size, so
+ * update latency is one batch, never one full buffer; poll() wakes the loop when
+ * a time-based publish is due even if the feed has gone quiet.
+ * * @return: 0 at EOF or on a signal, 1 on a read error.
+ */
+static int stream_feed(int fd){
+    char *buffer = malloc(STREAM_READ_BLOCK);
+    size_t filled = 0;
+    int skipping = 0;
+    int status = 0;
+
+    if (buffer == NULL){
+        return 1;
+    }
+    while (!engine_stop){
+        int timeout = -1;
+        if (options.publish_ms > 0){
+            long long due = stream_published_ns + options.publish_ms * 1000000LL - monotonic_ns();
+            timeout = due > 0 ? (int)((due + 999999) / 1000000) : 0;
+        }
+        struct pollfd descriptor = { .fd = fd, .events = POLLIN };
+        int ready = poll(&descriptor, 1, timeout);
+        if (ready < 0 && errno != EINTR){
+            status = 1;
+            break;
+        }
+        if (ready > 0){
+            ssize_t got = read(fd, buffer + filled, STREAM_READ_BLOCK - filled);
+            if (got < 0 && errno != EINTR){
+                status = 1;
+                break;
+            }
+            if (got == 0){
+                //A final line without a newline still counts; a torn binary record does not.
+                if (filled > 0 && !skipping && !options.binary){
+                    stream_line(buffer, buffer + filled, realtime_ns());
+                }
+                else if (filled > 0){
+                    stream_stats.rejected++;
+                }
+                break;
+            }
+            if (got > 0){
+                long long received = monotonic_ns();
+                filled += got;
+                //A line longer than the whole buffer is dropped up to its newline.
+                if (skipping){
+                    char *newline = memchr(buffer, '\n', filled);
+                    size_t rest = newline != NULL ? buffer + filled - (newline + 1) : 0;
+                    memmove(buffer, newline != NULL ? newline + 1 : buffer, rest);
+                    filled = rest;
+                    skipping = (newline == NULL);
+                }
+                size_t used = stream_apply(buffer, filled, realtime_ns());
+                memmove(buffer, buffer + used, filled - used);
+                filled -= used;
+                if (filled == STREAM_READ_BLOCK){
+                    stream_stats.rejected++;
+                    skipping = 1;
+                    filled = 0;
+                }
+                long long spent = monotonic_ns() - received;
+                stream_stats.busy_ns += spent;
+                if (spent > stream_stats.max_batch_ns){
+                    stream_stats.max_batch_ns = spent;
+                }
+            }
+        }
+        if (options.publish_ms > 0 && monotonic_ns() - stream_published_ns >= options.publish_ms * 1000000LL){
+            stream_publish();
+        }
+    }
+    free(buffer);
+    return status;
+}
+
+/**
+ * Streaming mode entry point: serves stdin, or loopback TCP connections one after
+ * another (state carries over between them), and publishes once more before returning.
+ * * @param source: "-" for stdin or "tcp:PORT".
+ * @return: 0 on a clean end, 1 on a bad source or an I/O error.
+ */
+int stream_run(const char* source){
+    int status = 0;
+
+    install_stop_handlers();
+    stream_stats.start_ns = monotonic_ns();
+    stream_published_ns = stream_stats.start_ns;
+
+    if (strcmp(source, "-") == 0){
+        status = stream_feed(STDIN_FILENO);
+    }
+    else if (strncmp(source, "tcp:", 4) == 0){
+        int port = atoi(source + 4);
+        int reuse = 1;
+        struct sockaddr_in address;
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (port < 1 || port > 65535 || listener < 0){
+            return 1;
+        }
+        //Loopback only: the feed handler runs on the same host.
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 4) != 0){
+            close(listener);
+            return 1;
+        }
+        while (!engine_stop && status == 0){
+            int connection = accept(listener, NULL, NULL);
+            if (connection < 0){
+                status = (errno == EINTR) ? 0 : 1;
+                continue;
+            }
+            status = stream_feed(connection);
+            close(connection);
+            stream_publish();
+        }
+        close(listener);
+    }
+    else{
+        return 1;
+    }
+    stream_publish();
+    return status;
+}
+
+void report_stream(void){
+    long long elapsed_ns = monotonic_ns() - stream_stats.start_ns;
+    fprintf(stderr, "{\"event\":\"stream\",\"events\":%ld,\"rejected\":%ld,\"assets\":%d,\"publishes\":%ld,"
+            "\"elapsed_ns\":%lld,\"busy_ns\":%lld,\"events_per_sec\":%.1f,\"busy_events_per_sec\":%.1f,"
+            "\"max_batch_ns\":%lld,\"max_publish_ns\":%lld}\n",
+            stream_stats.events, stream_stats.rejected, stream_stats.assets, stream_stats.publishes,
+            elapsed_ns, stream_stats.busy_ns,
+            elapsed_ns > 0 ? stream_stats.events / (elapsed_ns / 1e9) : 0,
+            stream_stats.busy_ns > 0 ? stream_stats.events / (stream_stats.busy_ns / 1e9) : 0,
+            stream_stats.max_batch_ns, stream_stats.max_publish_ns);
+}
+
+void reset_buckets(void){
+    for (int i = 0; i < TABLE_SIZE; i++){
+        if (buckets[i] != NULL){
+            free(buckets[i]->returns);
+            free(buckets[i]);
+            buckets[i] = NULL;
+        }
+    }
+    memset(ingest_moments, 0, sizeof(ingest_moments));
+    rows_ingested = 0;
+}
+
+//Seqlock writer side: readers retry while seq is odd or has moved on.
+static void seqlock_write_begin(_Atomic uint32_t* seq){
+    atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void seqlock_write_end(_Atomic uint32_t* seq){
+    atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) + 1, memory_order_release);
+}
+
+/**
+ * Reloads the dataset and rewrites every slot (and its histogram and samples).
+ * Each block is prepared off to the side and copied in under its seqlock, so the
+ * window in which readers retry is a memcpy, not an analysis.
+ * * @param segment: The mapped shared segment.
+ * @return: 0 on success, 1 if the file could not be read (the old results stay up).
+ */
+static int daemon_publish(const char* csv_path, char* segment){
+    ShmHeader *header = (ShmHeader*)segment;
+    ShmHistogram histogram;
+    //--shm-samples publishes the returns as generated, not as the select left them.
+    float *generated = NULL;
+    FILE *input;
+    int status;
+
+    if (header->sample_capacity > 0 && (generated = malloc(sizeof(float) * SIM_SAMPLES)) == NULL){
+        return 1;
+    }
+    if ((input = fopen(csv_path, "r")) == NULL){
+        free(generated);
+        return 1;
+    }
+    reset_buckets();
+    phase_begin(PHASE_INGESTION);
+    status = ingest_file(input);
+    phase_end(PHASE_INGESTION);
+    fclose(input);
+    if (status != 0){
+        free(generated);
+        return 1;
+    }
+    for (int index = 0; index < TABLE_SIZE; index++){
+        ShmSlot *slot = (ShmSlot*)(segment + header->slots_offset) + index;
+        ShmHistogram *shared_histogram = (ShmHistogram*)(segment + header->histograms_offset) + index;
+        float *simulated = NULL;
+        ResultRecord record;
+
+        memset(&histogram, 0, sizeof(histogram));
+        status = buckets[index] == NULL ? 3 : analyze_bucket(index, &simulated, &histogram, generated);
+        memset(&record, 0, sizeof(record));
+        if (buckets[index] != NULL){
+            encode_result(buckets[index], &record);
+        }
+        seqlock_write_begin(&slot->seq);
+        slot->status = status;
+        slot->updated_ns = realtime_ns();
+        memcpy(&slot->record, &record, sizeof(record));
+        seqlock_write_end(&slot->seq);
+
+        //analyze_bucket() binned the samples while generating them; a failed bucket publishes empty bins.
+        if (simulated == NULL){
+            memset(&histogram, 0, sizeof(histogram));
+        }
+        seqlock_write_begin(&shared_histogram->seq);
+        memcpy((char*)shared_histogram + sizeof(histogram.seq), (char*)&histogram + sizeof(histogram.seq),
+               sizeof(histogram) - sizeof(histogram.seq));
+        seqlock_write_end(&shared_histogram->seq);
+
+        if (header->sample_capacity > 0){
+            ShmSamples *samples = (ShmSamples*)(segment + header->samples_offset) + index;
+            seqlock_write_begin(&samples->seq);
+            samples->count = simulated != NULL ? SIM_SAMPLES : 0;
+            if (simulated != NULL){
+                memcpy(samples->values, generated, sizeof(float) * SIM_SAMPLES);
+            }
+            seqlock_write_end(&samples->seq);
+        }
+        free(simulated);
+    }
+    free(generated);
+    atomic_fetch_add_explicit(&header->generation, 1, memory_order_release);
+    return 0;
+}
+
+//Same file as last time: device, inode, size and modification time all unchanged.
+static int same_file_state(const struct stat* a, const struct stat* b){
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino && a->st_size == b->st_size
+        && a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+/**
+ * Daemon entry point. A fresh segment is created on every start (any stale one is
+ * unlinked first, so old readers keep a consistent if outdated mapping and notice
+ * the new inode). The dataset is re-published once a change has held still for one
+ * refresh period, so a file caught mid-upload is not published half-written.
+ * * @param csv_path: The dataset to watch (e.g. the dashboard's upload path).
+ * @return: 0 on a clean stop, 1 if the segment cannot be created.
+ */
+int daemon_run(const char* csv_path){
+    size_t slots_offset = sizeof(ShmHeader);
+    size_t histograms_offset = slots_offset + TABLE_SIZE * sizeof(ShmSlot);
+    size_t samples_offset = histograms_offset + TABLE_SIZE * sizeof(ShmHistogram);
+    size_t size = samples_offset + (options.shm_samples ? TABLE_SIZE * sizeof(ShmSamples) : 0);
+    struct stat published = {0};
+    struct stat pending = {0};
+    int have_published = 0;
+    int have_pending = 0;
+
+    shm_unlink(options.shm_name);
+    int fd = shm_open(options.shm_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0){
+        return 1;
+    }
+    if (ftruncate(fd, size) != 0){
+        close(fd);
+        shm_unlink(options.shm_name);
+        return 1;
+    }
+    char *segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED){
+        shm_unlink(options.shm_name);
+        return 1;
+    }
+    //A new segment is zero-filled: every slot starts even (readable) with status 0 and no record.
+    ShmHeader *header = (ShmHeader*)segment;
+    header->version = SHM_SCHEMA_VERSION;
+    header->header_size = sizeof(ShmHeader);
+    header->slot_count = TABLE_SIZE;
+    header->slot_size = sizeof(ShmSlot);
+    header->histogram_bins = SHM_HISTOGRAM_BINS;
+    header->histogram_size = sizeof(ShmHistogram);
+    header->sample_capacity = options.shm_samples ? SIM_SAMPLES : 0;
+    header->sample_size = options.shm_samples ? sizeof(ShmSamples) : 0;
+    header->slots_offset = slots_offset;
+    header->histograms_offset = histograms_offset;
+    header->samples_offset = options.shm_samples ? samples_offset : 0;
+    header->started_ns = realtime_ns();
+    for (int index = 0; index < TABLE_SIZE; index++){
+        ((ShmSlot*)(segment + slots_offset))[index].status = 3;
+    }
+    atomic_thread_fence(memory_order_release);
+    memcpy(header->magic, "RISKSHM", 8);
+
+    install_stop_handlers();
+    rng_seed(&engine_rng, time(NULL));
+    while (!engine_stop){
+        struct stat current;
+        if (stat(csv_path, &current) == 0){
+            if (have_pending && same_file_state(&current, &pending)
+                && !(have_published && same_file_state(&current, &published))){
+                if (daemon_publish(csv_path, segment) == 0){
+                    published = current;
+                    have_published = 1;
+                }
+            }
+            pending = current;
+            have_pending = 1;
+        }
+        struct timespec pause = { options.refresh_ms / 1000, (options.refresh_ms % 1000) * 1000000L };
+        nanosleep(&pause, NULL);
+    }
+    munmap(segment, size);
+    shm_unlink(options.shm_name);
+    return 0;
+}
+
+/**
+ * Recognises the start of a gzip (1f 8b) or zlib (CM 8 with a valid header check) stream.
+ * * @param got: Number of valid bytes at 'magic'.
+ */
+static int compressed_header(const unsigned char* magic, size_t got){
+    return got >= 2 && ((magic[0] == 0x1f && magic[1] == 0x8b)
+                        || ((magic[0] & 0x0f) == 8 && (magic[0] >> 4) <= 7 && (magic[0] * 256 + magic[1]) % 31 == 0));
+}
+
+int ingest_file(FILE* input){
+    char magic[sizeof(((SnapshotHeader*)0)->magic)];
+    size_t got = fread(magic, 1, sizeof(magic), input);
+    //Regular files only: the peeked bytes are handed back by seeking to the start.
+    if (fseek(input, 0, SEEK_SET) != 0){
+        return 1;
+    }
+    if (got == sizeof(magic) && memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0){
+        return snapshot_load(input);
+    }
+    if (got == sizeof(magic) && memcmp(magic, COLUMNS_MAGIC, sizeof(magic)) == 0){
+        return columns_load(input);
+    }
+    //gzip or zlib: decompressed as the parser reads.
+    if (compressed_header((const unsigned char*)magic, got)){
+        FILE *text = inflate_open(input);
+        if (text == NULL){
+            return 1;
+        }
+        int status = options.pipeline ? ingest_pipeline(text) : ingest_stream(text);
+        //A corrupt or truncated stream surfaces as a read error, not as a short dataset.
+        if (ferror(text)){
+            status = 1;
+        }
+        fclose(text);
+        return status;
+    }
+    return options.pipeline ? ingest_pipeline(input) : ingest_stream(input);
+}
+
+//State of one inflate_open() stream.
+typedef struct {
+    FILE *compressed;
+    z_stream zs;
+    unsigned char in[INFLATE_BLOCK];
+    //Set once the compressed input is exhausted after a complete stream.
+    int finished;
+} InflateCookie;
+
+/**
+ * fopencookie read hook: inflates into the caller's buffer, refilling from the compressed
+ * stream as needed. Concatenated gzip members are decoded one after another.
+ * * @return: Bytes produced, 0 at the end, -1 on corrupt or truncated input.
+ */
+static ssize_t inflate_read(void* cookie, char* buffer, size_t size){
+    InflateCookie *state = cookie;
+    state->zs.next_out = (unsigned char*)buffer;
+    state->zs.avail_out = size > UINT32_MAX ? UINT32_MAX : (uInt)size;
+
+    while (state->zs.avail_out > 0 && !state->finished){
+        if (state->zs.avail_in == 0){
+            size_t got = fread(state->in, 1, sizeof(state->in), state->compressed);
+            if (got == 0){
+                //Input ended mid-stream: the upload was cut short.
+                errno = EIO;
+                return -1;
+            }
+            state->zs.next_in = state->in;
+            state->zs.avail_in = got;
+        }
+        int status = inflate(&state->zs, Z_NO_FLUSH);
+        if (status == Z_STREAM_END){
+            //Another member may follow; otherwise the data is complete.
+            if (state->zs.avail_in == 0){
+                int next = fgetc(state->compressed);
+                if (next == EOF){
+                    state->finished = 1;
+                    break;
+                }
+                state->in[0] = (unsigned char)next;
+                state->zs.next_in = state->in;
+                state->zs.avail_in = 1;
+            }
+            inflateReset(&state->zs);
+        }
+        else if (status != Z_OK && status != Z_BUF_ERROR){
+            errno = EIO;
+            return -1;
+        }
+    }
+    return (ssize_t)(size - state->zs.avail_out);
+}
+
+static int inflate_close(void* cookie){
+    InflateCookie *state = cookie;
+    inflateEnd(&state->zs);
+    free(state);
+    return 0;
+}
+
+/**
+ * Streams a compressed upload into the CSV parser: the returned FILE* yields the
+ * decompressed text one fread() at a time, so only INFLATE_BLOCK compressed bytes and the
+ * parser's own block are ever in memory, never the whole file.
+ * * @param compressed: Stream positioned at the gzip or zlib header.
+ * @return: A read-only stream of the decompressed bytes, or NULL on failure.
+ */
+FILE* inflate_open(FILE* compressed){
+    InflateCookie *state = calloc(1, sizeof(InflateCookie));
+    if (state == NULL){
+        return NULL;
+    }
+    state->compressed = compressed;
+    //Window bits 15 + 32: detect gzip or zlib framing from the header.
+    if (inflateInit2(&state->zs, 15 + 32) != Z_OK){
+        free(state);
+        return NULL;
+    }
+    cookie_io_functions_t hooks = { .read = inflate_read, .close = inflate_close };
+    FILE *text = fopencookie(state, "r", hooks);
+    if (text == NULL){
+        inflate_close(state);
+    }
+    return text;
+}
+
+/**
+ * Exact moments of an array of returns, accumulated in double.
+ */
+static Moments returns_moments(const float* returns, int count){
+    Moments moments = {0, 0, 0};
+
+    if (count > 0){
+        double average = kernels.sum(returns, count) / count;
+        float rounded = (float)average;
+        //The kernel centres on a float; shift its sum of squares to the exact double mean.
+        double shift = average - rounded;
+        moments.count = count;
+        moments.mean = average;
+        moments.m2 = kernels.sum_sq_dev(returns, count, rounded) - count * shift * shift;
+    }
+    return moments;
+}
+
+/**
+ * Exact moments of a bucket's returns. Reuses the pipeline's (or the multi-file merge's)
+ * moments when they cover the whole bucket.
+ */
+static Moments bucket_moments(int index){
+    Portfolio *bucket = buckets[index];
+
+    if (ingest_moments[index].count == bucket->day_count){
+        return ingest_moments[index];
+    }
+    return returns_moments(bucket->returns, bucket->day_count);
+}
+
+/**
+ * Slots a snapshot reserves for an array of 'day_count' returns: the returns plus the
+ * spare --append fills, rounded so the next array stays SNAPSHOT_ALIGN-aligned.
+ */
+static uint64_t snapshot_capacity(uint64_t day_count){
+    uint64_t spare = day_count / SNAPSHOT_SPARE_DIVISOR;
+    uint64_t per_line = SNAPSHOT_ALIGN / sizeof(float);
+    if (spare < SNAPSHOT_SPARE_MIN){
+        spare = SNAPSHOT_SPARE_MIN;
+    }
+    return (day_count + spare + per_line - 1) / per_line * per_line;
+}
+
+/**
+ * Writes the snapshot next to its destination and renames it into place, so a
+ * concurrent reader sees either the old file or the complete new one.
+ * * @param path: Destination file.
+ * @return: 0 on success, 1 on I/O failure.
+ */
+int snapshot_write(const char* path){
+    SnapshotHeader header;
+    SnapshotEntry entries[TABLE_SIZE];
+    char staging[4096];
+    uint64_t offset;
+    int count = 0;
+    int status = 0;
+
+    memset(&header, 0, sizeof(header));
+    memset(entries, 0, sizeof(entries));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.rows = rows_ingested;
+    offset = sizeof(header) + sizeof(SnapshotEntry) * TABLE_SIZE;
+    for (int index = 0; index < TABLE_SIZE; index++){
+        if (buckets[index] == NULL){
+            continue;
+        }
+        SnapshotEntry *entry = &entries[count++];
+        Moments moments = bucket_moments(index);
+        memcpy(entry->type_name, buckets[index]->type_name, strnlen(buckets[index]->type_name, sizeof(entry->type_name) - 1));
+        entry->bucket = index;
+        entry->day_count = buckets[index]->day_count;
+        entry->capacity = snapshot_capacity(entry->day_count);
+        offset = (offset + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+        entry->data_offset = offset;
+        entry->moments_count = moments.count;
+        entry->mean = moments.mean;
+        entry->m2 = moments.m2;
+        entry->ewma_var = ewma_fold(0, 0, buckets[index]->returns, buckets[index]->day_count);
+        offset += sizeof(float) * entry->capacity;
+    }
+    header.bucket_count = count;
+
+    if (snprintf(staging, sizeof(staging), "%s.tmp", path) >= (int)sizeof(staging)){
+        return 1;
+    }
+    FILE *output = fopen(staging, "wb");
+    if (output == NULL){
+        return 1;
+    }
+    //Entries are written with room for every bucket, so array offsets never depend on the count.
+    if (fwrite(&header, sizeof(header), 1, output) != 1 || fwrite(entries, sizeof(entries), 1, output) != 1){
+        status = 1;
+    }
+    //Alignment padding and spare capacity are skipped over, leaving holes that read as zeros.
+    for (int i = 0; i < count && status == 0; i++){
+        Portfolio *bucket = buckets[entries[i].bucket];
+        if (fseeko(output, entries[i].data_offset, SEEK_SET) != 0
+            || fwrite(bucket->returns, sizeof(float), bucket->day_count, output) != (size_t)bucket->day_count){
+            status = 1;
+        }
+    }
+    if (status == 0 && (fflush(output) != 0 || ftruncate(fileno(output), offset) != 0)){
+        status = 1;
+    }
+    if (fclose(output) != 0 || status != 0 || rename(staging, path) != 0){
+        remove(staging);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Reads a snapshot written by snapshot_write(): every bucket's array is read whole
+ * (no parsing), and its stored moments seed ingest_moments.
+ * * @param input: The snapshot, positioned at its start.
+ * @return: 0 on success, 1 if the file is truncated, from another version, or memory runs out.
+ */
+int snapshot_load(FILE* input){
+    SnapshotHeader header;
+    SnapshotEntry entries[TABLE_SIZE];
+
+    if (fread(&header, sizeof(header), 1, input) != 1 || memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+        || header.version != SNAPSHOT_VERSION || header.bucket_count > TABLE_SIZE
+        || fread(entries, sizeof(entries), 1, input) != 1){
+        return 1;
+    }
+    for (uint32_t i = 0; i < header.bucket_count; i++){
+        SnapshotEntry *entry = &entries[i];
+        entry->type_name[sizeof(entry->type_name) - 1] = '\0';
+        if (entry->bucket >= TABLE_SIZE || buckets[entry->bucket] != NULL || entry->day_count > INT32_MAX
+            || entry->day_count > entry->capacity || fseeko(input, entry->data_offset, SEEK_SET) != 0){
+            return 1;
+        }
+        Portfolio *bucket = create_bucket(entry->type_name);
+        if (bucket == NULL){
+            return 1;
+        }
+        buckets[entry->bucket] = bucket;
+        if (entry->day_count > (uint64_t)bucket->capacity){
+            float *grown = realloc(bucket->returns, sizeof(float) * entry->day_count);
+            if (grown == NULL){
+                return 1;
+            }
+            bucket->returns = grown;
+            bucket->capacity = entry->day_count;
+        }
+        if (fread(bucket->returns, sizeof(float), entry->day_count, input) != entry->day_count){
+            return 1;
+        }
+        bucket->day_count = entry->day_count;
+        ingest_moments[entry->bucket].count = entry->moments_count;
+        ingest_moments[entry->bucket].mean = entry->mean;
+        ingest_moments[entry->bucket].m2 = entry->m2;
+    }
+    rows_ingested = header.rows;
+    return 0;
+}
+
+double ewma_fold(double ewma_var, long seen, const float* values, long count){
+    //The streaming recursion (stream_event()): around a zero mean, seeded with the first squared return.
+    for (long i = 0; i < count; i++){
+        double change = values[i];
+        ewma_var = seen + i == 0 ? change * change
+                                 : options.ewma_lambda * ewma_var + (1 - options.ewma_lambda) * change * change;
+    }
+    return ewma_var;
+}
+
+/**
+ * Nightly refresh without a re-parse: the delta CSV is ingested into the (empty) buckets,
+ * then each bucket's rows go to the end of its snapshot array. They land in the spare
+ * capacity in place; an array whose spare is used up is copied once to the end of the file
+ * with fresh spare (rebuild with --snapshot to reclaim the old space), and a new asset gets
+ * an array there too. Moments merge exactly (Chan et al.) and the EWMA variance continues
+ * from its stored value, so the cost follows the delta, not the history.
+ *
+ * Returns are written and synced before the header and entry table are rewritten, so a
+ * reader or a crash sees the old day counts over intact data until the new ones land.
+ * * @param path: The snapshot to extend (version SNAPSHOT_VERSION).
+ * @param delta_path: The new rows, as CSV (optionally compressed) or a column upload.
+ * @return: 0 on success, 1 on I/O failure or a malformed snapshot.
+ */
+int snapshot_append(const char* path, const char* delta_path){
+    SnapshotHeader header;
+    SnapshotEntry entries[TABLE_SIZE];
+    float copy[4096];
+    int status = 0;
+
+    phase_begin(PHASE_VALIDATION);
+    FILE *snapshot = fopen(path, "r+b");
+    FILE *delta = fopen(delta_path, "r");
+    if (snapshot == NULL || delta == NULL || fread(&header, sizeof(header), 1, snapshot) != 1
+        || memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION
+        || header.bucket_count > TABLE_SIZE || fread(entries, sizeof(entries), 1, snapshot) != 1){
+        status = 1;
+        goto done;
+    }
+    phase_end(PHASE_VALIDATION);
+    phase_begin(PHASE_INGESTION);
+    if (ingest_file(delta) != 0){
+        status = 1;
+        goto done;
+    }
+    phase_end(PHASE_INGESTION);
+
+    phase_begin(PHASE_OUTPUT);
+    if (fseeko(snapshot, 0, SEEK_END) != 0){
+        status = 1;
+        goto done;
+    }
+    uint64_t end = ftello(snapshot);
+    for (int index = 0; index < TABLE_SIZE; index++){
+        Portfolio *bucket = buckets[index];
+        SnapshotEntry *entry = NULL;
+        if (bucket == NULL){
+            continue;
+        }
+        for (uint32_t i = 0; i < header.bucket_count; i++){
+            if (entries[i].bucket == (uint32_t)index){
+                entry = &entries[i];
+            }
+        }
+        if (entry == NULL){
+            entry = &entries[header.bucket_count++];
+            memset(entry, 0, sizeof(*entry));
+            memcpy(entry->type_name, bucket->type_name, strnlen(bucket->type_name, sizeof(entry->type_name) - 1));
+            entry->bucket = index;
+        }
+        if (entry->day_count + bucket->day_count > INT32_MAX){
+            status = 1;
+            goto done;
+        }
+        //Out of spare: move the array (in bounded copies) to the end of the file, with new spare.
+        if (entry->day_count + bucket->day_count > entry->capacity){
+            uint64_t moved = (end + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+            for (uint64_t done_count = 0; done_count < entry->day_count; ){
+                uint64_t step = entry->day_count - done_count;
+                step = step < sizeof(copy) / sizeof(float) ? step : sizeof(copy) / sizeof(float);
+                if (fseeko(snapshot, entry->data_offset + sizeof(float) * done_count, SEEK_SET) != 0
+                    || fread(copy, sizeof(float), step, snapshot) != step
+                    || fseeko(snapshot, moved + sizeof(float) * done_count, SEEK_SET) != 0
+                    || fwrite(copy, sizeof(float), step, snapshot) != step){
+                    status = 1;
+                    goto done;
+                }
+                done_count += step;
+            }
+            entry->data_offset = moved;
+            entry->capacity = snapshot_capacity(entry->day_count + bucket->day_count);
+            end = moved + sizeof(float) * entry->capacity;
+        }
+        if (fseeko(snapshot, entry->data_offset + sizeof(float) * entry->day_count, SEEK_SET) != 0
+            || fwrite(bucket->returns, sizeof(float), bucket->day_count, snapshot) != (size_t)bucket->day_count){
+            status = 1;
+            goto done;
+        }
+        Moments moments = {entry->moments_count, entry->mean, entry->m2};
+        Moments added = bucket_moments(index);
+        moments_merge(&moments, added.count, added.mean, added.m2);
+        entry->moments_count = moments.count;
+        entry->mean = moments.mean;
+        entry->m2 = moments.m2;
+        entry->ewma_var = ewma_fold(entry->ewma_var, entry->day_count, bucket->returns, bucket->day_count);
+        entry->day_count += bucket->day_count;
+    }
+    header.rows += rows_ingested;
+    //A relocated last array needs its spare inside the file; the gap stays a hole.
+    if (fflush(snapshot) != 0 || ftruncate(fileno(snapshot), end) != 0 || fsync(fileno(snapshot)) != 0
+        || fseeko(snapshot, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, snapshot) != 1
+        || fwrite(entries, sizeof(entries), 1, snapshot) != 1 || fflush(snapshot) != 0){
+        status = 1;
+        goto done;
+    }
+    phase_end(PHASE_OUTPUT);
+
+done:
+    if (delta != NULL){
+        fclose(delta);
+    }
+    if (snapshot != NULL && fclose(snapshot) != 0){
+        status = 1;
+    }
+    return status;
+}
+
+/**
+ * Loads a column upload: every block's values are read straight into the end of its
+ * symbol's bucket (grown once per block), so there is no text to parse. Buckets are
+ * found by name exactly as store_entry() finds them for CSV rows.
+ * * @param input: A stream positioned at the ColumnHeader.
+ * @return: 0 on success, 1 if the upload is malformed or truncated, or memory runs out.
+ */
+int columns_load(FILE* input){
+    ColumnHeader header;
+    ColumnBlock block;
+    struct stat file;
+    uint64_t rows = 0;
+
+    if (fread(&header, sizeof(header), 1, input) != 1 || memcmp(header.magic, COLUMNS_MAGIC, sizeof(header.magic)) != 0
+        || fstat(fileno(input), &file) != 0){
+        return 1;
+    }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    header.version = __builtin_bswap32(header.version);
+    header.blocks = __builtin_bswap32(header.blocks);
+    header.rows = __builtin_bswap64(header.rows);
+#endif
+    if (header.version != COLUMNS_VERSION){
+        return 1;
+    }
+    for (uint32_t b = 0; b < header.blocks; b++){
+        if (fread(&block, sizeof(block), 1, input) != 1){
+            return 1;
+        }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        block.count = __builtin_bswap32(block.count);
+#endif
+        block.type_name[sizeof(block.type_name) - 1] = '\0';
+        if (block.type_name[0] == '\0'){
+            return 1;
+        }
+        int index = hash(block.type_name);
+        if (buckets[index] == NULL){
+            buckets[index] = create_bucket(block.type_name);
+            if (buckets[index] == NULL){
+                return 1;
+            }
+        }
+        Portfolio *bucket = buckets[index];
+        //Counts are client-supplied: a block may claim no more rows than the header has left,
+        //nor more values than the file has bytes left, before anything is allocated for it.
+        off_t position = ftello(input);
+        if (block.count > (uint32_t)(INT32_MAX - bucket->day_count) || block.count > header.rows - rows
+            || position < 0 || (uint64_t)block.count * sizeof(float) > (uint64_t)(file.st_size - position)){
+            return 1;
+        }
+        int needed = bucket->day_count + (int)block.count;
+        if (needed > bucket->capacity){
+            float *grown = realloc(bucket->returns, sizeof(float) * needed);
+            if (grown == NULL){
+                return 1;
+            }
+            bucket->returns = grown;
+            bucket->capacity = needed;
+        }
+        float *values = bucket->returns + bucket->day_count;
+        if (fread(values, sizeof(float), block.count, input) != block.count){
+            return 1;
+        }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        for (uint32_t i = 0; i < block.count; i++){
+            uint32_t bits;
+            memcpy(&bits, &values[i], sizeof(bits));
+            bits = __builtin_bswap32(bits);
+            memcpy(&values[i], &bits, sizeof(bits));
+        }
+#endif
+        bucket->day_count = needed;
+        rows += block.count;
+    }
+    //The header's row total guards against a client that miscounted its own blocks.
+    if (rows != header.rows){
+        return 1;
+    }
+    rows_ingested = rows;
+    return 0;
+}
+
+static FILE* ooc_rewind(FILE* input);
+
+static int emit_input(RawData* entry, void* context){
+    InputTable *table = context;
+    if (table_store(table->buckets, entry) != 0) return 1;
+    table->rows++;
+    return 0;
+}
+
+/**
+ * Pool body of ingest_inputs(): parses each input of [begin, end) into its own symbol
+ * table, so parsing threads share nothing, then takes the moments of each of its buckets
+ * so the merge only has to combine them.
+ */
+static void ingest_input_range(void* arg, long begin, long end){
+    InputTable *tables = arg;
+
+    for (long i = begin; i < end; i++){
+        InputTable *table = &tables[i];
+        FILE *input = fopen(table->path, "r");
+        FILE *text = input != NULL ? ooc_rewind(input) : NULL;
+        table->status = text == NULL || stream_rows(text, emit_input, NULL, table) != 0 || ferror(text);
+        if (text != NULL && text != input){
+            fclose(text);
+        }
+        if (input != NULL){
+            fclose(input);
+        }
+        for (int index = 0; index < TABLE_SIZE && table->status == 0; index++){
+            if (table->buckets[index] != NULL){
+                table->moments[index] = returns_moments(table->buckets[index]->returns, table->buckets[index]->day_count);
+            }
+        }
+    }
+}
+
+/**
+ * Data split across files (one per exchange or per day) without concatenating them first:
+ * every file is one pool task, parsed into its own table, and the tables are merged in
+ * the order given. A symbol's returns are its runs from each file back to back, the first
+ * file's array growing once to hold them all, and its name the first file's, so the
+ * dataset is exactly the one the concatenated CSV would give. The per-file moments merge
+ * exactly (Chan et al.) into ingest_moments, sparing the statistics passes.
+ * * @param paths: CSV files (plain or compressed), in concatenation order.
+ * @param count: Number of paths.
+ * @return: 0 on success, 1 if any file is unreadable, not CSV text, or memory runs out.
+ */
+int ingest_inputs(char** paths, int count){
+    InputTable *tables = calloc(count, sizeof(InputTable));
+    int status = 0;
+
+    if (tables == NULL){
+        return 1;
+    }
+    for (int i = 0; i < count; i++){
+        tables[i].path = paths[i];
+    }
+    //One file per task: idle threads steal whole files, which evens out uneven sizes.
+    parallel_for(count, 1, ingest_input_range, tables);
+
+    for (int i = 0; i < count; i++){
+        status |= tables[i].status;
+        rows_ingested += tables[i].rows;
+    }
+    for (int index = 0; index < TABLE_SIZE && status == 0; index++){
+        long total = 0;
+        for (int i = 0; i < count; i++){
+            if (tables[i].buckets[index] != NULL){
+                total += tables[i].buckets[index]->day_count;
+            }
+        }
+        if (total > INT32_MAX){
+            status = 1;
+            break;
+        }
+        for (int i = 0; i < count && status == 0; i++){
+            Portfolio *part = tables[i].buckets[index];
+            Moments *moments = &tables[i].moments[index];
+            if (part == NULL){
+                continue;
+            }
+            if (buckets[index] == NULL){
+                float *grown = realloc(part->returns, sizeof(float) * total);
+                if (grown == NULL){
+                    status = 1;
+                    break;
+                }
+                part->returns = grown;
+                part->capacity = total;
+                buckets[index] = part;
+                tables[i].buckets[index] = NULL;
+                ingest_moments[index] = *moments;
+            }
+            else{
+                memcpy(buckets[index]->returns + buckets[index]->day_count, part->returns, sizeof(float) * part->day_count);
+                buckets[index]->day_count += part->day_count;
+                moments_merge(&ingest_moments[index], moments->count, moments->mean, moments->m2);
+            }
+        }
+    }
+    for (int i = 0; i < count; i++){
+        for (int index = 0; index < TABLE_SIZE; index++){
+            if (tables[i].buckets[index] != NULL){
+                free(tables[i].buckets[index]->returns);
+                free(tables[i].buckets[index]);
+            }
+        }
+    }
+    free(tables);
+    return status;
+}
+
+/**
+ * Rewinds the input for another out-of-core pass (or a multi-file ingestion's only one),
+ * unwrapping compression the way ingest_file() does. Only CSV text streams past; snapshots
+ * and column files are already in-memory layouts and are rejected.
+ * * @param input: The regular file main() opened.
+ * @return: The stream to read (the input itself, or an inflater to fclose()), NULL on failure.
+ */
+static FILE* ooc_rewind(FILE* input){
+    unsigned char magic[sizeof(((SnapshotHeader*)0)->magic)];
+
+    if (fseek(input, 0, SEEK_SET) != 0){
+        return NULL;
+    }
+    size_t got = fread(magic, 1, sizeof(magic), input);
+    if (fseek(input, 0, SEEK_SET) != 0){
+        return NULL;
+    }
+    if (got == sizeof(magic) && (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0
+                                 || memcmp(magic, COLUMNS_MAGIC, sizeof(magic)) == 0)){
+        return NULL;
+    }
+    return compressed_header(magic, got) ? inflate_open(input) : input;
+}
+
+/**
+ * Streams the whole input once through 'emit', chunk by chunk.
+ * * @return: 0 on success, 1 on I/O failure.
+ */
+static int ooc_pass(FILE* input, int (*emit)(RawData* entry, void* context), void (*chunk_done)(void* context)){
+    FILE *text = ooc_rewind(input);
+    if (text == NULL){
+        return 1;
+    }
+    int status = stream_rows(text, emit, chunk_done, NULL);
+    if (ferror(text)){
+        status = 1;
+    }
+    if (text != input){
+        fclose(text);
+    }
+    return status;
+}
+
+//First pass: a Welford step into the asset's chunk moments, and one sketch increment.
+static int ooc_scan(RawData* entry, void* context){
+    (void)context;
+    OutOfCoreAsset *asset = &ooc_assets[hash(entry->type)];
+    if (!asset->present){
+        memcpy(asset->type_name, entry->type, sizeof(asset->type_name));
+        asset->present = 1;
+    }
+    moments_merge(&asset->chunk, 1, entry->value, 0);
+    sketch_add(&asset->sketch, entry->value);
+    rows_ingested++;
+    return 0;
+}
+
+//End of a chunk: its moments merge exactly into the running totals (Chan et al.).
+static void ooc_merge_chunk(void* context){
+    (void)context;
+    for (int index = 0; index < TABLE_SIZE; index++){
+        Moments *chunk = &ooc_assets[index].chunk;
+        moments_merge(&ooc_assets[index].moments, chunk->count, chunk->mean, chunk->m2);
+        chunk->count = 0;
+        chunk->mean = 0;
+        chunk->m2 = 0;
+    }
+}
+
+/**
+ * Maps a float to an unsigned key with the same order (negatives flipped, positives offset),
+ * so brackets are exact integer ranges: no rounding at their edges, and infinities sort
+ * where they belong.
+ */
+static inline uint32_t ooc_key(float value){
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+static inline float ooc_value(uint32_t key){
+    uint32_t bits = (key & 0x80000000u) ? key & 0x7fffffffu : ~key;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//Sets the bracket and the shift that spreads it over at most OOC_REFINE_BINS bins.
+static void ooc_bracket(OutOfCoreAsset* asset, uint32_t low, uint32_t high){
+    asset->low = low;
+    asset->high = high;
+    asset->shift = 0;
+    while (((uint64_t)(high - low) >> asset->shift) >= OOC_REFINE_BINS){
+        asset->shift++;
+    }
+}
+
+//Filter passes: counts what lies below the bracket and keeps (and bins) what lies inside it.
+static int ooc_filter(RawData* entry, void* context){
+    (void)context;
+    OutOfCoreAsset *asset = &ooc_assets[hash(entry->type)];
+    uint32_t key = ooc_key(entry->value);
+
+    if (asset->resolved || asset->candidates == NULL){
+        return 0;
+    }
+    if (key < asset->low){
+        asset->below++;
+        return 0;
+    }
+    if (key > asset->high){
+        return 0;
+    }
+    if (asset->inside < asset->capacity){
+        asset->candidates[asset->inside] = entry->value;
+    }
+    if (asset->inside == 0 || key < asset->inside_min){
+        asset->inside_min = key;
+    }
+    if (asset->inside == 0 || key > asset->inside_max){
+        asset->inside_max = key;
+    }
+    asset->inside++;
+    asset->refine[(key - asset->low) >> asset->shift]++;
+    return 0;
+}
+
+/**
+ * Turns the sketch bin holding the asset's rank into the first bracket. The bin's value
+ * range is widened by a bin on each side, so a value the logarithm put in a neighbouring
+ * bin is still inside; the outermost bins are open-ended.
+ */
+static void ooc_first_bracket(OutOfCoreAsset* asset){
+    double gamma = (1 + SKETCH_ALPHA) / (1 - SKETCH_ALPHA);
+    const QuantileSketch *sketch = &asset->sketch;
+    uint64_t seen = 0;
+    double low = -INFINITY;
+    double high = INFINITY;
+
+    //Same walk as sketch_quantile(): largest losses first, then the zero bin, then gains.
+    for (int i = SKETCH_BINS - 1; i >= 0 && seen <= (uint64_t)asset->rank; i--){
+        seen += sketch->negative[i];
+        if (seen > (uint64_t)asset->rank){
+            low = i >= SKETCH_BINS - 2 ? -INFINITY : -SKETCH_MIN_VALUE * pow(gamma, i + 1);
+            high = i < 2 ? SKETCH_MIN_VALUE : -SKETCH_MIN_VALUE * pow(gamma, i - 2);
+        }
+    }
+    if (seen <= (uint64_t)asset->rank){
+        seen += sketch->zero;
+        if (seen > (uint64_t)asset->rank){
+            low = -SKETCH_MIN_VALUE * gamma;
+            high = SKETCH_MIN_VALUE * gamma;
+        }
+    }
+    for (int i = 0; i < SKETCH_BINS && seen <= (uint64_t)asset->rank; i++){
+        seen += sketch->positive[i];
+        if (seen > (uint64_t)asset->rank){
+            low = i < 2 ? -SKETCH_MIN_VALUE : SKETCH_MIN_VALUE * pow(gamma, i - 2);
+            high = i >= SKETCH_BINS - 2 ? INFINITY : SKETCH_MIN_VALUE * pow(gamma, i + 1);
+        }
+    }
+    ooc_bracket(asset, ooc_key((float)low), ooc_key((float)high));
+}
+
+/**
+ * Settles an asset after a filter pass. The rank inside the bracket is exact because
+ * 'below' was counted, not estimated. Either the candidates all fit (select the answer),
+ * all share one key (that value is the answer), the bracket missed the rank (move it to
+ * the side the rank lies on), or too many values fall inside (narrow it to the bin holding
+ * the rank, which shrinks it OOC_REFINE_BINS-fold per pass).
+ */
+static void ooc_settle(OutOfCoreAsset* asset){
+    if (asset->rank < asset->below){
+        ooc_bracket(asset, 0, asset->low - 1);
+    }
+    else if (asset->rank >= asset->below + asset->inside){
+        ooc_bracket(asset, asset->high + 1, UINT32_MAX);
+    }
+    else if (asset->inside <= asset->capacity){
+        asset->quantile = kernels.select(asset->candidates, (int)asset->inside, (int)(asset->rank - asset->below));
+        asset->resolved = 1;
+    }
+    else if (asset->inside_min == asset->inside_max){
+        asset->quantile = ooc_value(asset->inside_min);
+        asset->resolved = 1;
+    }
+    else{
+        long seen = asset->below;
+        uint32_t bin = 0;
+        while (seen + (long)asset->refine[bin] <= asset->rank){
+            seen += asset->refine[bin];
+            bin++;
+        }
+        uint32_t low = asset->low + (bin << asset->shift);
+        uint64_t high = (uint64_t)low + ((uint64_t)1 << asset->shift) - 1;
+        ooc_bracket(asset, low, high < asset->high ? (uint32_t)high : asset->high);
+    }
+    asset->below = 0;
+    asset->inside = 0;
+    memset(asset->refine, 0, sizeof(asset->refine));
+}
+
+int out_of_core_run(FILE* input, char* user_query){
+    int selected[TABLE_SIZE] = {0};
+    int pending = 0;
+    int written = 0;
+    int found = 0;
+    int status = 0;
+
+    // Pass 1: exact moments and the quantile sketch of every asset.
+    phase_begin(PHASE_INGESTION);
+    if (ooc_pass(input, ooc_scan, ooc_merge_chunk) != 0){
+        return 1;
+    }
+    phase_end(PHASE_INGESTION);
+    phase_begin(PHASE_RETRIEVAL);
+    for (int index = 0; index < TABLE_SIZE; index++){
+        if (ooc_assets[index].present && (options.all ? asset_selected(index) : index == hash(user_query))){
+            selected[index] = 1;
+            found++;
+        }
+    }
+    if (found == 0){
+        return 3;
+    }
+    phase_end(PHASE_RETRIEVAL);
+    // Passes 2+: filter to the bracket until every selected asset's quantile is pinned down.
+    phase_begin(PHASE_MODELING);
+    for (int index = 0; index < TABLE_SIZE; index++){
+        OutOfCoreAsset *asset = &ooc_assets[index];
+        if (!selected[index]){
+            continue;
+        }
+        asset->rank = (long)(asset->moments.count * VAR_LEVEL) - 1;
+        if (asset->rank < 0){
+            asset->rank = 0;
+        }
+        asset->capacity = asset->moments.count < OOC_CANDIDATES ? asset->moments.count : OOC_CANDIDATES;
+        asset->candidates = malloc(sizeof(float) * asset->capacity);
+        if (asset->candidates == NULL){
+            status = 1;
+            goto done;
+        }
+        ooc_first_bracket(asset);
+        pending++;
+    }
+    while (pending > 0){
+        if (ooc_pass(input, ooc_filter, NULL) != 0){
+            status = 1;
+            goto done;
+        }
+        pending = 0;
+        for (int index = 0; index < TABLE_SIZE; index++){
+            if (selected[index] && !ooc_assets[index].resolved){
+                ooc_settle(&ooc_assets[index]);
+                pending += !ooc_assets[index].resolved;
+            }
+        }
+    }
+    phase_end(PHASE_MODELING);
+    // Output: one record per selected asset with variance, as analyze_all() writes them.
+    for (int index = 0; index < TABLE_SIZE; index++){
+        OutOfCoreAsset *asset = &ooc_assets[index];
+        Portfolio result = {0};
+        if (!selected[index]){
+            continue;
+        }
+        double variance = asset->moments.count > 1 ? asset->moments.m2 / (asset->moments.count - 1) : 0;
+        if (variance <= 0){
+            continue;
+        }
+        memcpy(result.type_name, asset->type_name, sizeof(result.type_name));
+        result.day_count = asset->moments.count > INT_MAX ? INT_MAX : (int)asset->moments.count;
+        result.mean = asset->moments.mean;
+        result.std_dev = sqrt(variance);
+        result.worst_case_historical = asset->quantile;
+        //worst_case keeps its in-memory meaning (the Monte Carlo quantile), so the VaR range a
+        //record reports is the same kind of figure with or without --out-of-core.
+        float *simulated = synth_data_generator(result.mean, result.std_dev, SIM_SAMPLES);
+        if (simulated == NULL){
+            status = 1;
+            goto done;
+        }
+        analyze(simulated, SIM_SAMPLES, &result);
+        free(simulated);
+        samples_generated += SIM_SAMPLES;
+        rieman(NULL, result.mean, result.std_dev, &result);
+        phase_begin(PHASE_OUTPUT);
+        if (send2python(&result, result.type_name) != 0){
+            status = 1;
+            goto done;
+        }
+        phase_end(PHASE_OUTPUT);
+        written++;
+    }
+    status = written ? 0 : 2;
+
+done:
+    for (int index = 0; index < TABLE_SIZE; index++){
+        free(ooc_assets[index].candidates);
+        ooc_assets[index].candidates = NULL;
+    }
+    return status;
+}
+
+/**
+ * Portable delimiter scan; also finishes the ragged tail for the SIMD variants.
+ * * @param buffer: Bytes to classify.
+ * @param length: Number of bytes; the last word is partially filled when length % 64 != 0.
+ * @param commas: Receives ceil(length/64) words of ',' position bits.
+ * @param newlines: Receives ceil(length/64) words of '\n' position bits.
+ */
+void scan_delimiters_scalar(const char* buffer, size_t length, uint64_t* commas, uint64_t* newlines){
+    for (size_t word = 0; word * 64 < length; word++){
+        uint64_t comma_bits = 0;
+        uint64_t newline_bits = 0;
+        size_t limit = length - word * 64 < 64 ? length - word * 64 : 64;
+        for (size_t bit = 0; bit < limit; bit++){
+            char c = buffer[word * 64 + bit];
+            comma_bits |= (uint64_t)(c == ',') << bit;
+            newline_bits |= (uint64_t)(c == '\n') << bit;
+        }
+        commas[word] = comma_bits;
+        newlines[word] = newline_bits;
+    }
+}
+
+/**
+ * Portable double-accumulated sum (the loop mean() always used).
+ */
+double sum_scalar(const float* data, int count){
+    double total_value = 0;
+    for (int i = 0; i < count; i++){
+        total_value += data[i];
+    }
+    return total_value;
+}
+
+/**
+ * Portable sum of squared deviations (the loop stand_dev() always used).
+ */
+double sum_sq_dev_scalar(const float* data, int count, float mean){
+    double total_value = 0;
+    for (int i = 0; i < count; i++){
+        total_value += (data[i]-mean) * (data[i]-mean);
+    }
+    return total_value;
+}
+
+/**
+ * Seeds the RNG lanes with SplitMix64 so even seeds like 0 or 1 give well-mixed,
+ * non-zero xoshiro states, and no two lanes share a stream.
+ * * @param seed: Any 64-bit value (main() uses the current time).
+ */
+void rng_seed(EngineRng* rng, unsigned long long seed){
+    rng->seed = seed;
+    rng->streams = 0;
+    for (int word = 0; word < 4; word++){
+        for (int lane = 0; lane < RNG_LANES; lane++){
+            seed += 0x9E3779B97F4A7C15ULL;
+            unsigned long long z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            rng->s[word][lane] = (uint32_t)((z ^ (z >> 31)) >> 32);
+        }
+    }
+}
+
+/**
+ * Derives an independent generator for one chunk of a parallel simulation.
+ * The child seed is a SplitMix64 finalisation of (parent seed, stream), so
+ * children never share the consecutive seed runs rng_seed() walks through.
+ * * @param stream: Chunk number, offset by the streams the parent already handed out.
+ */
+void rng_split(EngineRng* parent, EngineRng* child, unsigned long long stream){
+    unsigned long long z = parent->seed + (parent->streams + stream + 1) * 0xD1B54A32D192ED03ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    rng_seed(child, z ^ (z >> 31));
+}
+
+/**
+ * Portable xoshiro128+; writes out[row + lane] exactly like the SIMD variants,
+ * so every tier produces the same uniforms from the same seed.
+ * * @param count: Number of uniforms, a multiple of RNG_LANES.
+ */
+void uniforms_scalar(EngineRng* rng, float* out, int count){
+    for (int row = 0; row < count; row += RNG_LANES){
+        for (int lane = 0; lane < RNG_LANES; lane++){
+            uint32_t s0 = rng->s[0][lane];
+            uint32_t s1 = rng->s[1][lane];
+            uint32_t s2 = rng->s[2][lane];
+            uint32_t s3 = rng->s[3][lane];
+            uint32_t result = s0 + s3;
+            uint32_t t = s1 << 9;
+            s2 ^= s0;
+            s3 ^= s1;
+            s1 ^= s2;
+            s0 ^= s3;
+            s2 ^= t;
+            s3 = (s3 << 11) | (s3 >> 21);
+            rng->s[0][lane] = s0;
+            rng->s[1][lane] = s1;
+            rng->s[2][lane] = s2;
+            rng->s[3][lane] = s3;
+            out[row + lane] = (float)(int32_t)((result >> 8) + 1) * (1.0f / 16777216.0f);
+        }
+    }
+}
+
+/**
+ * Portable Box-Muller transform.
+ * Within each BOX_MULLER_BLOCK, uniform j (0-15) is the radius draw and uniform
+ * 16+j the angle draw of pair j; the cosine projection lands in slot j and the
+ * sine projection in slot 16+j. Each pair is read before it is written, so the
+ * transform can run in place.
+ * * @param count: Number of values, a multiple of BOX_MULLER_BLOCK.
+ */
+void box_muller_scalar(const float* uniforms, float* out, int count, float mean, float deviation){
+    const int half = BOX_MULLER_BLOCK / 2;
+    for (int block = 0; block < count; block += BOX_MULLER_BLOCK){
+        for (int j = 0; j < half; j++){
+            float u1 = uniforms[block + j];
+            float u2 = uniforms[block + half + j];
+            /* * BOX-MULLER TRANSFORM:
+             * 'gravity' calculates the magnitude of the offset from the mean.
+             */
+            float gravity = sqrtf(-2*logf(u1));
+            // Project magnitude onto the Z-axis using trigonometric oscillation
+            out[block + j] = (gravity*(cosf((PI*2)*u2))*deviation)+mean;
+            out[block + half + j] = (gravity*(sinf((PI*2)*u2))*deviation)+mean;
+        }
+    }
+}
+
+/**
+ * Portable normal density, the Riemann scan's original per-step formula.
+ * * @param x: Points to evaluate; out receives one height per point.
+ */
+void gaussian_density_scalar(const float* x, float* out, int count, float mean, float deviation){
+    for (int i = 0; i < count; i++){
+        // Calculate the Z-Score (distance from mean in standard deviations)
+        float z = (x[i]-mean)/deviation;
+
+        /* * GAUSSIAN HEIGHT CALCULATION:
+         * 1. (z*z) squares the distance to remove negative signs.
+         * 2. expf(-0.5 * z^2) creates the characteristic bell shape.
+         * 3. INV_SQRT_2PI / deviation normalizes the total area to 1.0.
+         */
+        out[i] = INV_SQRT_2PI/deviation*(expf(-0.5*(z*z)));
+    }
+}
+
+//libm references for the vector math (simd_math.h) and its benchmarks.
+void log_array_scalar(const float* in, float* out, int count){
+    for (int i = 0; i < count; i++){
+        out[i] = logf(in[i]);
+    }
+}
+
+void exp_array_scalar(const float* in, float* out, int count){
+    for (int i = 0; i < count; i++){
+        out[i] = expf(in[i]);
+    }
+}
+
+void sincos_array_scalar(const float* in, float* sin_out, float* cos_out, int count){
+    for (int i = 0; i < count; i++){
+        sin_out[i] = sinf(in[i]);
+        cos_out[i] = cosf(in[i]);
+    }
+}
+
+void sqrt_array_scalar(const float* in, float* out, int count){
+    for (int i = 0; i < count; i++){
+        out[i] = sqrtf(in[i]);
+    }
+}
+
+/**
+ * Portable quickselect (Wirth's variant; duplicate-safe and in place).
+ * * @param k: 0-based rank of the value to return.
+ * @return: The k-th smallest value; data is left partitioned around it.
+ */
+float select_scalar(float* data, int count, int k){
+    int left = 0;
+    int right = count - 1;
+    while (left < right){
+        float pivot = data[k];
+        int i = left;
+        int j = right;
+        do {
+            while (data[i] < pivot) i++;
+            while (pivot < data[j]) j--;
+            if (i <= j){
+                float swap = data[i];
+                data[i] = data[j];
+                data[j] = swap;
+                i++;
+                j--;
+            }
+        } while (i <= j);
+        if (j < k) left = i;
+        if (k < i) right = j;
+    }
+    return data[k];
+}
+
+#ifdef SIMD_X86
+//Instantiate the kernel template once per instruction set.
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#define KERNEL_WIDTH 4
+#define KERNEL_SUFFIX sse2
+#include "simd_kernels.h"
+#undef KERNEL_WIDTH
+#undef KERNEL_SUFFIX
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#define KERNEL_WIDTH 8
+#define KERNEL_SUFFIX avx2
+#include "simd_kernels.h"
+#undef KERNEL_WIDTH
+#undef KERNEL_SUFFIX
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx2,fma")
+#define KERNEL_WIDTH 16
+#define KERNEL_SUFFIX avx512
+#include "simd_kernels.h"
+#undef KERNEL_WIDTH
+#undef KERNEL_SUFFIX
+#pragma GCC pop_options
+#endif
+
+//One table per tier. SSE2 has no lane-compress or variable permute, so its
+//select stays scalar.
+const EngineKernels kernel_tiers[SIMD_TIER_COUNT] = {
+    {"scalar", scan_delimiters_scalar, sum_scalar, sum_sq_dev_scalar,
+     uniforms_scalar, box_muller_scalar, select_scalar, gaussian_density_scalar,
+     log_array_scalar, exp_array_scalar, sincos_array_scalar, sqrt_array_scalar},
+#ifdef SIMD_X86
+    {"sse2", scan_delimiters_sse2, sum_sse2, sum_sq_dev_sse2,
+     uniforms_sse2, box_muller_sse2, select_scalar, gaussian_density_sse2,
+     log_array_sse2, exp_array_sse2, sincos_array_sse2, sqrt_array_sse2},
+    {"avx2", scan_delimiters_avx2, sum_avx2, sum_sq_dev_avx2,
+     uniforms_avx2, box_muller_avx2, select_avx2, gaussian_density_avx2,
+     log_array_avx2, exp_array_avx2, sincos_array_avx2, sqrt_array_avx2},
+    {"avx512", scan_delimiters_avx512, sum_avx512, sum_sq_dev_avx512,
+     uniforms_avx512, box_muller_avx512, select_avx512, gaussian_density_avx512,
+     log_array_avx512, exp_array_avx512, sincos_array_avx512, sqrt_array_avx512},
+#endif
+};
+
+/**
+ * Reports whether this CPU (and OS, for the wider register state) runs a tier.
+ * __builtin_cpu_supports reads cpuid once and checks XCR0 for AVX/AVX-512 state.
+ */
+static int tier_supported(SimdTier tier){
+    if (tier == SIMD_SCALAR){
+        return 1;
+    }
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    switch (tier){
+        case SIMD_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case SIMD_AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case SIMD_AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+        default:
+            return 0;
+    }
+#else
+    return 0;
+#endif
+}
+
+const EngineKernels* kernels_for_tier(SimdTier tier){
+    if (tier < 0 || tier >= SIMD_TIER_COUNT || !tier_supported(tier)){
+        return NULL;
+    }
+    return &kernel_tiers[tier];
+}
+
+/**
+ * Binds 'kernels' to the widest tier the CPU supports.
+ * ENGINE_SIMD=<tier name> caps the choice so every path can be exercised on
+ * one machine; asking for a tier the CPU lacks falls back to the best lower one.
+ */
+void kernels_init(void){
+    SimdTier cap = SIMD_TIER_COUNT - 1;
+    const char *requested = getenv("ENGINE_SIMD");
+
+    if (requested != NULL){
+        for (int tier = 0; tier < SIMD_TIER_COUNT; tier++){
+            if (kernel_tiers[tier].name != NULL && strcmp(requested, kernel_tiers[tier].name) == 0){
+                cap = tier;
+            }
+        }
+    }
+    for (int tier = cap; tier >= SIMD_SCALAR; tier--){
+        const EngineKernels *table = kernels_for_tier(tier);
+        if (table != NULL){
+            kernels = *table;
+            return;
+        }
+    }
 }
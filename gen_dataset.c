@@ -0,0 +1,429 @@
+/**
+ * Synthetic Dataset Generator
+ * Writes return datasets in the engine's CSV format (SYMBOL,return per line) at any
+ * scale, for load and scale testing of the ingestion and simulation paths.
+ * * Build: gcc -O2 -pthread gen_dataset.c -o gen_dataset -lm
+ * * Usage: ./gen_dataset --rows N [--symbols K] [--name-length L] [--order grouped|interleaved]
+ *                      [--dist normal|student-t|garch] [--dof V] [--mean M] [--vol S]
+ *                      [--garch-alpha A] [--garch-beta B] [--seed S] [--threads T]
+ *                      [--chunk-rows C] [--output file]
+ *
+ * DETERMINISM:
+ * The row range is cut into fixed chunks of --chunk-rows rows. Each chunk draws from
+ * its own RNG stream derived from (seed, chunk index) and starts every symbol's
+ * GARCH state from the unconditional variance. Threads claim chunks dynamically but
+ * write them strictly in chunk order, so the output depends only on the seed and the
+ * options, never on the thread count or scheduling.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+
+//Rows per independently generated chunk; also the unit of work handed to a thread.
+#define CHUNK_ROWS (1 << 20)
+//Upper bound on a formatted line: 19 symbol bytes, comma, sign, 9 integer digits, point, 6 decimals, newline.
+#define MAX_LINE 40
+//The engine stores symbols in char[20], so names must leave room for the terminator.
+#define MAX_NAME 19
+#define PI 3.14159265358979323846
+
+//Return dynamics the generator can produce.
+typedef enum { DIST_NORMAL, DIST_STUDENT_T, DIST_GARCH } Distribution;
+
+//Everything that determines the output; two runs with equal GenOptions write identical files.
+typedef struct {
+    long long rows;
+    int symbols;
+    int name_length;
+    //1 = all rows of a symbol are contiguous, 0 = symbols round-robin row by row.
+    int grouped;
+    Distribution dist;
+    //Degrees of freedom of the Student-t innovations (student-t and garch).
+    double dof;
+    double mean;
+    double vol;
+    double garch_alpha;
+    double garch_beta;
+    unsigned long long seed;
+    int threads;
+    long long chunk_rows;
+} GenOptions;
+
+//xoshiro256** state; fast, statistically strong, and trivially re-seedable per chunk.
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+//Per-symbol GARCH(1,1) recursion state.
+typedef struct {
+    double variance;
+    double last_shock;
+} GarchState;
+
+GenOptions opts = {
+    .rows = 0, .symbols = 1, .name_length = 0, .grouped = 1, .dist = DIST_NORMAL,
+    .dof = 4.0, .mean = 0.0003, .vol = 0.01, .garch_alpha = 0.08, .garch_beta = 0.9,
+    .seed = 42, .threads = 0, .chunk_rows = CHUNK_ROWS
+};
+char (*symbol_names)[MAX_NAME + 1];
+int *symbol_name_lengths;
+//Per-symbol volatility multiplier so symbols are not statistically identical.
+double *symbol_vol;
+FILE *output;
+
+//Chunk hand-out and in-order write sequencing shared by the worker threads.
+pthread_mutex_t chunk_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t chunk_written = PTHREAD_COND_INITIALIZER;
+long long next_chunk = 0;
+long long next_to_write = 0;
+long long chunk_count;
+int write_failed = 0;
+
+/**
+ * SplitMix64 finaliser: turns any 64-bit counter into a well-mixed seed.
+ */
+static uint64_t splitmix64(uint64_t x){
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static void rng_seed(Rng *rng, uint64_t seed, uint64_t stream){
+    uint64_t x = splitmix64(seed ^ splitmix64(stream));
+    for (int i = 0; i < 4; i++){
+        x = splitmix64(x);
+        rng->s[i] = x;
+    }
+}
+
+static uint64_t rng_next(Rng *rng){
+    uint64_t *s = rng->s;
+    uint64_t result = s[1] * 5;
+    result = ((result << 7) | (result >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+/**
+ * Uniform double in the open interval (0, 1), safe to pass to log().
+ */
+static double rng_uniform(Rng *rng){
+    return ((rng_next(rng) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Standard normal draw via the Box-Muller transform (one of the pair is discarded
+ * to keep the stream position independent of call parity).
+ */
+static double rng_normal(Rng *rng){
+    double u1 = rng_uniform(rng);
+    double u2 = rng_uniform(rng);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * PI * u2);
+}
+
+/**
+ * Gamma(shape, 1) draw using Marsaglia & Tsang's squeeze method.
+ */
+static double rng_gamma(Rng *rng, double shape){
+    if (shape < 1.0){
+        //Boost to shape+1 and correct with a uniform power (Marsaglia & Tsang, section 6).
+        return rng_gamma(rng, shape + 1.0) * pow(rng_uniform(rng), 1.0 / shape);
+    }
+    double d = shape - 1.0 / 3.0;
+    double c = 1.0 / sqrt(9.0 * d);
+    for (;;){
+        double x = rng_normal(rng);
+        double v = 1.0 + c * x;
+        if (v <= 0){
+            continue;
+        }
+        v = v * v * v;
+        double u = rng_uniform(rng);
+        if (log(u) < 0.5 * x * x + d - d * v + d * log(v)){
+            return d * v;
+        }
+    }
+}
+
+/**
+ * Student-t draw rescaled to unit variance, so --vol means the same thing for every
+ * distribution and only the tails change.
+ */
+static double rng_student_t(Rng *rng, double dof){
+    double chi2 = 2.0 * rng_gamma(rng, dof / 2.0);
+    return rng_normal(rng) / sqrt(chi2 / dof) * sqrt((dof - 2.0) / dof);
+}
+
+/**
+ * Draws the next return of a symbol under the selected dynamics.
+ * * @param rng: The chunk's RNG stream.
+ * @param symbol: Symbol index, selecting its volatility multiplier and GARCH state.
+ * @param garch: The chunk's per-symbol GARCH states (unused for iid distributions).
+ * @return: The simulated daily return.
+ */
+static double next_return(Rng *rng, int symbol, GarchState *garch){
+    double vol = opts.vol * symbol_vol[symbol];
+
+    if (opts.dist == DIST_NORMAL){
+        return opts.mean + vol * rng_normal(rng);
+    }
+    if (opts.dist == DIST_STUDENT_T){
+        return opts.mean + vol * rng_student_t(rng, opts.dof);
+    }
+    //GARCH(1,1): today's variance reacts to yesterday's shock, giving volatility clusters.
+    GarchState *state = &garch[symbol];
+    double target = vol * vol;
+    double omega = target * (1.0 - opts.garch_alpha - opts.garch_beta);
+    if (state->variance == 0){
+        state->variance = target;
+        state->last_shock = vol;
+    }
+    state->variance = omega + opts.garch_alpha * state->last_shock * state->last_shock
+                      + opts.garch_beta * state->variance;
+    state->last_shock = sqrt(state->variance) * rng_student_t(rng, opts.dof);
+    return opts.mean + state->last_shock;
+}
+
+/**
+ * Formats a return with six decimals, matching what atof() in the engine reads back.
+ * Hand-rolled because snprintf("%.6f") would dominate the generator's run time.
+ * * @param out: Destination; at least 18 bytes.
+ * @return: Number of bytes written.
+ */
+static int format_return(char *out, double value){
+    int n = 0;
+    if (value < 0){
+        out[n++] = '-';
+        value = -value;
+    }
+    //Clamp absurd tail draws so the integer part always fits the line buffer.
+    if (value > 999999999.0){
+        value = 999999999.0;
+    }
+    unsigned long long scaled = (unsigned long long)(value * 1000000.0 + 0.5);
+    unsigned long long whole = scaled / 1000000;
+    unsigned int frac = scaled % 1000000;
+    char digits[20];
+    int d = 0;
+    do {
+        digits[d++] = '0' + whole % 10;
+        whole /= 10;
+    } while (whole > 0);
+    while (d > 0){
+        out[n++] = digits[--d];
+    }
+    out[n++] = '.';
+    for (int i = 5; i >= 0; i--){
+        out[n + i] = '0' + frac % 10;
+        frac /= 10;
+    }
+    return n + 6;
+}
+
+/**
+ * Builds the symbol table. With 5 or fewer symbols and no --name-length the
+ * dashboard's asset names are used, so small files work with the UI as-is.
+ * Otherwise names are SYM followed by a zero-padded index, padded to --name-length.
+ * * @return: 0 on success, 1 if the names cannot be made unique at that length.
+ */
+static int build_symbols(void){
+    const char *assets[] = {"EQUITY", "CRYPTO", "BOND", "COMMODITY", "FOREX"};
+    int digits = 1;
+    for (int k = opts.symbols - 1; k >= 10; k /= 10){
+        digits++;
+    }
+
+    symbol_names = malloc(sizeof(*symbol_names) * opts.symbols);
+    symbol_name_lengths = malloc(sizeof(int) * opts.symbols);
+    symbol_vol = malloc(sizeof(double) * opts.symbols);
+    if (symbol_names == NULL || symbol_name_lengths == NULL || symbol_vol == NULL){
+        return 1;
+    }
+    if (opts.name_length != 0 && opts.name_length < digits + 1){
+        return 1;
+    }
+    for (int k = 0; k < opts.symbols; k++){
+        if (opts.symbols <= 5 && opts.name_length == 0){
+            strcpy(symbol_names[k], assets[k]);
+        }
+        else{
+            //Letter padding first, then the index, so every name is exactly name_length bytes.
+            int pad = opts.name_length == 0 ? 3 : opts.name_length - digits;
+            char name[48];
+            memset(name, 'X', pad);
+            memcpy(name, "SYM", pad < 3 ? pad : 3);
+            snprintf(name + pad, sizeof(name) - pad, "%0*d", digits, k);
+            if (strlen(name) > MAX_NAME){
+                return 1;
+            }
+            strcpy(symbol_names[k], name);
+        }
+        symbol_name_lengths[k] = strlen(symbol_names[k]);
+        //Spread multipliers over [0.5, 2.0) so per-symbol risk differs deterministically.
+        symbol_vol[k] = 0.5 + 1.5 * ((splitmix64(opts.seed ^ (0xC0FFEEULL + k)) >> 11) * (1.0 / 9007199254740992.0));
+    }
+    return 0;
+}
+
+/**
+ * Worker: claims chunks, formats them into a private buffer, then waits its turn
+ * to append the buffer to the output file.
+ */
+static void* worker(void *arg){
+    (void)arg;
+    char *buffer = malloc((size_t)opts.chunk_rows * MAX_LINE);
+    GarchState *garch = NULL;
+    if (opts.dist == DIST_GARCH){
+        garch = malloc(sizeof(GarchState) * opts.symbols);
+    }
+    if (buffer == NULL || (opts.dist == DIST_GARCH && garch == NULL)){
+        pthread_mutex_lock(&chunk_lock);
+        write_failed = 1;
+        pthread_cond_broadcast(&chunk_written);
+        pthread_mutex_unlock(&chunk_lock);
+        free(buffer);
+        return NULL;
+    }
+    long long rows_per_symbol = (opts.rows + opts.symbols - 1) / opts.symbols;
+
+    for (;;){
+        pthread_mutex_lock(&chunk_lock);
+        long long chunk = next_chunk++;
+        pthread_mutex_unlock(&chunk_lock);
+        if (chunk >= chunk_count){
+            break;
+        }
+
+        Rng rng;
+        rng_seed(&rng, opts.seed, (uint64_t)chunk);
+        if (garch != NULL){
+            memset(garch, 0, sizeof(GarchState) * opts.symbols);
+        }
+        long long first = chunk * opts.chunk_rows;
+        long long last = first + opts.chunk_rows;
+        if (last > opts.rows){
+            last = opts.rows;
+        }
+        size_t used = 0;
+        for (long long r = first; r < last; r++){
+            int symbol = opts.grouped ? (int)(r / rows_per_symbol) : (int)(r % opts.symbols);
+            memcpy(buffer + used, symbol_names[symbol], symbol_name_lengths[symbol]);
+            used += symbol_name_lengths[symbol];
+            buffer[used++] = ',';
+            used += format_return(buffer + used, next_return(&rng, symbol, garch));
+            buffer[used++] = '\n';
+        }
+
+        //Writes happen strictly in chunk order so the file is independent of scheduling.
+        pthread_mutex_lock(&chunk_lock);
+        while (next_to_write != chunk && !write_failed){
+            pthread_cond_wait(&chunk_written, &chunk_lock);
+        }
+        if (!write_failed && fwrite(buffer, 1, used, output) != used){
+            write_failed = 1;
+        }
+        next_to_write++;
+        pthread_cond_broadcast(&chunk_written);
+        int failed = write_failed;
+        pthread_mutex_unlock(&chunk_lock);
+        if (failed){
+            break;
+        }
+    }
+    free(garch);
+    free(buffer);
+    return NULL;
+}
+
+static int usage(const char *program){
+    fprintf(stderr, "usage: %s --rows N [--symbols K] [--name-length L] [--order grouped|interleaved]\n"
+                    "          [--dist normal|student-t|garch] [--dof V] [--mean M] [--vol S]\n"
+                    "          [--garch-alpha A] [--garch-beta B] [--seed S] [--threads T]\n"
+                    "          [--chunk-rows C] [--output file]\n", program);
+    return 1;
+}
+
+int main(int argc, char* argv[]){
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++){
+        if (i + 1 >= argc){
+            return usage(argv[0]);
+        }
+        const char *value = argv[i + 1];
+        if (strcmp(argv[i], "--rows") == 0) opts.rows = atoll(value);
+        else if (strcmp(argv[i], "--symbols") == 0) opts.symbols = atoi(value);
+        else if (strcmp(argv[i], "--name-length") == 0) opts.name_length = atoi(value);
+        else if (strcmp(argv[i], "--order") == 0 && strcmp(value, "grouped") == 0) opts.grouped = 1;
+        else if (strcmp(argv[i], "--order") == 0 && strcmp(value, "interleaved") == 0) opts.grouped = 0;
+        else if (strcmp(argv[i], "--dist") == 0 && strcmp(value, "normal") == 0) opts.dist = DIST_NORMAL;
+        else if (strcmp(argv[i], "--dist") == 0 && strcmp(value, "student-t") == 0) opts.dist = DIST_STUDENT_T;
+        else if (strcmp(argv[i], "--dist") == 0 && strcmp(value, "garch") == 0) opts.dist = DIST_GARCH;
+        else if (strcmp(argv[i], "--dof") == 0) opts.dof = atof(value);
+        else if (strcmp(argv[i], "--mean") == 0) opts.mean = atof(value);
+        else if (strcmp(argv[i], "--vol") == 0) opts.vol = atof(value);
+        else if (strcmp(argv[i], "--garch-alpha") == 0) opts.garch_alpha = atof(value);
+        else if (strcmp(argv[i], "--garch-beta") == 0) opts.garch_beta = atof(value);
+        else if (strcmp(argv[i], "--seed") == 0) opts.seed = strtoull(value, NULL, 10);
+        else if (strcmp(argv[i], "--threads") == 0) opts.threads = atoi(value);
+        else if (strcmp(argv[i], "--chunk-rows") == 0) opts.chunk_rows = atoll(value);
+        else if (strcmp(argv[i], "--output") == 0) path = value;
+        else return usage(argv[0]);
+        i++;
+    }
+    //Validate up front; a half-written 10 GB file is worse than no file.
+    if (opts.rows <= 0 || opts.symbols <= 0 || opts.name_length < 0 || opts.name_length > MAX_NAME
+        || opts.dof <= 2.0 || opts.vol < 0 || opts.chunk_rows <= 0
+        || opts.garch_alpha < 0 || opts.garch_beta < 0 || opts.garch_alpha + opts.garch_beta >= 1.0){
+        return usage(argv[0]);
+    }
+    if (build_symbols() != 0){
+        fprintf(stderr, "cannot build %d unique symbol names of at most %d bytes\n", opts.symbols, MAX_NAME);
+        return 1;
+    }
+    if (opts.threads <= 0){
+        opts.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (opts.threads <= 0){
+            opts.threads = 1;
+        }
+    }
+    output = stdout;
+    if (path != NULL && (output = fopen(path, "wb")) == NULL){
+        return 1;
+    }
+
+    chunk_count = (opts.rows + opts.chunk_rows - 1) / opts.chunk_rows;
+    pthread_t *workers = malloc(sizeof(pthread_t) * opts.threads);
+    if (workers == NULL){
+        return 1;
+    }
+    for (int t = 0; t < opts.threads; t++){
+        pthread_create(&workers[t], NULL, worker, NULL);
+    }
+    for (int t = 0; t < opts.threads; t++){
+        pthread_join(workers[t], NULL);
+    }
+    free(workers);
+
+    if (fflush(output) != 0){
+        write_failed = 1;
+    }
+    if (output != stdout){
+        fclose(output);
+    }
+    free(symbol_names);
+    free(symbol_name_lengths);
+    free(symbol_vol);
+    return write_failed ? 1 : 0;
+}
@@ -0,0 +1,285 @@
+"""
+END-TO-END LOAD HARNESS
+Drives the Flask endpoints over real HTTP (upload, save, engine bridge, JSON) and
+reports what users feel: throughput and latency percentiles from an HDR histogram.
+
+Usage:
+    python loadtest.py --spawn --concurrency 8 --requests 500 --rows 10000
+    python loadtest.py --url http://127.0.0.1:5000 --duration 30 --file big.csv --label subprocess
+
+Only loopback targets are accepted so a typo can never load-test someone else's server.
+Run once per bridge mode with a different --label and compare the JSON lines.
+"""
+import argparse
+import ipaddress
+import json
+import math
+import os
+import random
+import socket
+import subprocess
+import sys
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+import uuid
+
+
+class HdrHistogram:
+    """
+    HIGH DYNAMIC RANGE HISTOGRAM
+    Log-linear buckets (as in HdrHistogram): every power-of-two range is split into
+    the same number of linear sub-buckets, so relative error is bounded by the
+    significant-figure setting at any magnitude with fixed memory.
+    """
+
+    def __init__(self, highest=3_600_000_000, significant_figures=3):
+        # BUCKET GEOMETRY: 2 * 10^sf sub-buckets per power of two keeps error under 10^-sf.
+        self.sub_bucket_count = 2 ** math.ceil(math.log2(2 * 10 ** significant_figures))
+        self.sub_bucket_half = self.sub_bucket_count // 2
+        bucket_count = 1
+        smallest_untrackable = self.sub_bucket_count
+        while smallest_untrackable <= highest:
+            smallest_untrackable <<= 1
+            bucket_count += 1
+        self.highest = highest
+        self.counts = [0] * ((bucket_count + 1) * self.sub_bucket_half)
+        self.total = 0
+        self.min = None
+        self.max = 0
+        self.lock = threading.Lock()
+
+    def _index(self, value):
+        # BUCKET LOOKUP: the bit length picks the power of two, the top bits the sub-bucket.
+        bucket = max(value.bit_length() - int(math.log2(self.sub_bucket_count)), 0)
+        sub_bucket = value >> bucket
+        return (bucket + 1) * self.sub_bucket_half + (sub_bucket - self.sub_bucket_half)
+
+    def _value_at(self, index):
+        bucket = index // self.sub_bucket_half - 1
+        sub_bucket = index % self.sub_bucket_half + self.sub_bucket_half
+        if bucket < 0:
+            bucket = 0
+            sub_bucket -= self.sub_bucket_half
+        # Report the top of the bucket so percentiles never understate latency.
+        return ((sub_bucket + 1) << bucket) - 1
+
+    def record(self, value):
+        """Records one latency in microseconds (clamped to the trackable range)."""
+        value = min(max(int(value), 0), self.highest)
+        with self.lock:
+            self.counts[self._index(value)] += 1
+            self.total += 1
+            self.min = value if self.min is None else min(self.min, value)
+            self.max = max(self.max, value)
+
+    def percentile(self, pct):
+        """Returns the recorded value at the given percentile (0-100)."""
+        if self.total == 0:
+            return 0
+        target = max(1, math.ceil(self.total * pct / 100.0))
+        seen = 0
+        for index, count in enumerate(self.counts):
+            seen += count
+            if seen >= target:
+                return min(self._value_at(index), self.max)
+        return self.max
+
+
+def make_csv(rows, assets, seed):
+    """
+    SYNTHETIC PAYLOAD
+    Builds an in-memory CSV in the engine's SYMBOL,return format.
+    Larger datasets (or heavy tails) should come from gen_dataset via --file.
+    """
+    rng = random.Random(seed)
+    lines = [f"{assets[i % len(assets)]},{rng.gauss(0.0005, 0.02):.6f}" for i in range(rows)]
+    return ("\n".join(lines) + "\n").encode()
+
+
+def encode_multipart(fields, files):
+    """
+    MULTIPART ENCODING
+    Mirrors what the browser's FormData produces for the dashboard form.
+    """
+    boundary = uuid.uuid4().hex
+    parts = []
+    for name, value in fields.items():
+        parts.append(
+            f'--{boundary}\r\nContent-Disposition: form-data; name="{name}"\r\n\r\n{value}\r\n'.encode()
+        )
+    for name, (filename, payload) in files.items():
+        parts.append(
+            f'--{boundary}\r\nContent-Disposition: form-data; name="{name}"; filename="{filename}"\r\n'
+            f"Content-Type: text/csv\r\n\r\n".encode() + payload + b"\r\n"
+        )
+    parts.append(f"--{boundary}--\r\n".encode())
+    return b"".join(parts), f"multipart/form-data; boundary={boundary}"
+
+
+def require_loopback(url):
+    """
+    SAFETY CHECK
+    Refuses any target that does not resolve to a loopback address.
+    """
+    host = urllib.parse.urlparse(url).hostname or ""
+    try:
+        addresses = socket.getaddrinfo(host, None)
+    except socket.gaierror:
+        raise SystemExit(f"cannot resolve target {host}")
+    for info in addresses:
+        if not ipaddress.ip_address(info[4][0]).is_loopback:
+            raise SystemExit(f"refusing non-loopback target {host}")
+
+
+def spawn_app(port):
+    """
+    LOCAL SERVER
+    Starts app.py on the given port and waits until it accepts connections.
+    """
+    env = dict(os.environ, PORT=str(port))
+    here = os.path.dirname(os.path.abspath(__file__))
+    proc = subprocess.Popen([sys.executable, "app.py"], cwd=here, env=env,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    deadline = time.monotonic() + 15
+    while time.monotonic() < deadline:
+        try:
+            with socket.create_connection(("127.0.0.1", port), timeout=0.2):
+                return proc
+        except OSError:
+            time.sleep(0.1)
+    proc.kill()
+    raise SystemExit("app.py did not start listening within 15s")
+
+
+def free_port():
+    with socket.socket() as sock:
+        sock.bind(("127.0.0.1", 0))
+        return sock.getsockname()[1]
+
+
+def run(args):
+    """
+    LOAD LOOP
+    Each worker thread issues requests back to back (closed-loop), recording the
+    full request latency, until the request budget or the duration runs out.
+    """
+    url = args.url.rstrip("/") + args.endpoint
+    if args.file:
+        with open(args.file, "rb") as handle:
+            payload = handle.read()
+    else:
+        payload = make_csv(args.rows, args.assets.split(","), args.seed)
+    fields = {"investment_type": args.asset}
+    for extra in args.field:
+        key, _, value = extra.partition("=")
+        fields[key] = value
+    body, content_type = encode_multipart(fields, {"file_input_name": ("returns.csv", payload)})
+
+    histogram = HdrHistogram()
+    outcomes = {}
+    outcome_lock = threading.Lock()
+    issued = [0]
+    deadline = time.monotonic() + args.duration if args.duration else None
+
+    def claim():
+        # WORK BUDGET: either a fixed request count or a wall-clock duration.
+        with outcome_lock:
+            if deadline is not None:
+                return time.monotonic() < deadline
+            if issued[0] >= args.requests:
+                return False
+            issued[0] += 1
+            return True
+
+    def worker():
+        while claim():
+            request = urllib.request.Request(url, data=body, headers={"Content-Type": content_type})
+            start = time.perf_counter_ns()
+            try:
+                with urllib.request.urlopen(request, timeout=args.timeout) as response:
+                    response.read()
+                    status = response.status
+            except urllib.error.HTTPError as error:
+                status = error.code
+            except (urllib.error.URLError, OSError):
+                status = "connection_error"
+            histogram.record((time.perf_counter_ns() - start) // 1000)
+            with outcome_lock:
+                outcomes[status] = outcomes.get(status, 0) + 1
+
+    started = time.perf_counter()
+    threads = [threading.Thread(target=worker) for _ in range(args.concurrency)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    elapsed = time.perf_counter() - started
+
+    return {
+        "label": args.label,
+        "endpoint": args.endpoint,
+        "concurrency": args.concurrency,
+        "payload_bytes": len(payload),
+        "requests": histogram.total,
+        "elapsed_s": round(elapsed, 3),
+        "throughput_rps": round(histogram.total / elapsed, 2) if elapsed > 0 else 0,
+        "outcomes": {str(key): value for key, value in outcomes.items()},
+        "latency_us": {
+            "min": histogram.min or 0,
+            "p50": histogram.percentile(50),
+            "p90": histogram.percentile(90),
+            "p99": histogram.percentile(99),
+            "p99.9": histogram.percentile(99.9),
+            "max": histogram.max,
+        },
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Local HTTP load test for the risk engine dashboard.")
+    parser.add_argument("--url", default="http://127.0.0.1:5000")
+    parser.add_argument("--endpoint", default="/result")
+    parser.add_argument("--spawn", action="store_true", help="start app.py on a free local port")
+    parser.add_argument("--concurrency", type=int, default=4)
+    parser.add_argument("--requests", type=int, default=200)
+    parser.add_argument("--duration", type=float, default=0, help="seconds; overrides --requests")
+    parser.add_argument("--rows", type=int, default=1000, help="rows in the generated CSV")
+    parser.add_argument("--file", help="upload this file instead of a generated CSV")
+    parser.add_argument("--asset", default="EQUITY")
+    parser.add_argument("--assets", default="EQUITY,CRYPTO,BOND,COMMODITY,FOREX",
+                        help="symbols written into the generated CSV")
+    parser.add_argument("--field", action="append", default=[],
+                        help="extra form field key=value (e.g. a bridge mode switch)")
+    parser.add_argument("--label", default="default", help="tag for comparing bridge modes")
+    parser.add_argument("--seed", type=int, default=42)
+    parser.add_argument("--timeout", type=float, default=60)
+    parser.add_argument("--json", action="store_true", help="print only the JSON summary")
+    args = parser.parse_args()
+
+    server = None
+    if args.spawn:
+        port = free_port()
+        args.url = f"http://127.0.0.1:{port}"
+        server = spawn_app(port)
+    try:
+        require_loopback(args.url)
+        summary = run(args)
+    finally:
+        if server is not None:
+            server.terminate()
+            server.wait()
+
+    if not args.json:
+        latency = summary["latency_us"]
+        print(f"{summary['label']}: {summary['requests']} requests in {summary['elapsed_s']}s "
+              f"({summary['throughput_rps']} req/s) outcomes={summary['outcomes']}", file=sys.stderr)
+        print("latency (ms): " + "  ".join(f"{key}={value / 1000:.2f}" for key, value in latency.items()),
+              file=sys.stderr)
+    print(json.dumps(summary))
+
+
+if __name__ == "__main__":
+    main()
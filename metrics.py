@@ -0,0 +1,115 @@
+"""
+SERVICE METRICS
+A minimal Prometheus registry (counters, gauges, histograms) rendered in the text
+exposition format for /metrics. Engine-side figures (phase latencies, rows, simulated
+paths) come from the engine's own --timings report, not from Python wall clocks, so they
+measure the work itself rather than process start-up and pipe transfer.
+
+Values are per worker process: each Flask worker keeps its own registry, and Prometheus
+sums them when scraping several targets.
+"""
+import threading
+
+# LATENCY BUCKETS: Seconds, spanning sub-microsecond sub-steps up to multi-second ingestion.
+LATENCY_BUCKETS = (1e-6, 1e-5, 1e-4, 5e-4, 1e-3, 5e-3, 1e-2, 5e-2, 0.1, 0.5, 1.0, 5.0, 10.0)
+
+
+def _labels(names, values):
+    if not names:
+        return ""
+    pairs = ",".join(f'{name}="{value}"' for name, value in zip(names, values))
+    return "{" + pairs + "}"
+
+
+class _Metric:
+    kind = None
+
+    def __init__(self, registry, name, help, labels=(), sample=None):
+        self.name = name
+        self.help = help
+        self.label_names = tuple(labels)
+        # SCRAPE-TIME SAMPLING: sample() yields (labels, value) pairs read from existing state.
+        self._sample = sample
+        self._lock = threading.Lock()
+        self._values = {}
+        registry.append(self)
+
+    def _key(self, labels):
+        return tuple(str(labels[name]) for name in self.label_names)
+
+    def render(self):
+        if self._sample is not None:
+            sampled = {self._key(labels): value for labels, value in self._sample()}
+            with self._lock:
+                self._values.update(sampled)
+        lines = [f"# HELP {self.name} {self.help}", f"# TYPE {self.name} {self.kind}"]
+        with self._lock:
+            items = sorted(self._values.items())
+        for key, value in items:
+            lines.extend(self._samples(key, value))
+        return lines
+
+    def _samples(self, key, value):
+        return [f"{self.name}{_labels(self.label_names, key)} {value:g}"]
+
+
+class Counter(_Metric):
+    """Monotonic total; inc(), or sampled from a counter kept elsewhere."""
+    kind = "counter"
+
+    def inc(self, amount=1, **labels):
+        key = self._key(labels)
+        with self._lock:
+            self._values[key] = self._values.get(key, 0) + amount
+
+
+class Gauge(_Metric):
+    """Point-in-time value; set()/inc() directly, or sampled at scrape time."""
+    kind = "gauge"
+
+    def set(self, value, **labels):
+        with self._lock:
+            self._values[self._key(labels)] = value
+
+    def inc(self, amount=1, **labels):
+        key = self._key(labels)
+        with self._lock:
+            self._values[key] = self._values.get(key, 0) + amount
+
+
+class Histogram(_Metric):
+    """Cumulative-bucket histogram of observations (plus _sum and _count)."""
+    kind = "histogram"
+
+    def __init__(self, registry, name, help, labels=(), buckets=LATENCY_BUCKETS):
+        super().__init__(registry, name, help, labels)
+        self.buckets = tuple(buckets)
+
+    def observe(self, value, **labels):
+        key = self._key(labels)
+        with self._lock:
+            counts = self._values.get(key)
+            if counts is None:
+                counts = self._values[key] = [0] * len(self.buckets) + [0, 0.0]
+            for index, bound in enumerate(self.buckets):
+                if value <= bound:
+                    counts[index] += 1
+            counts[-2] += 1
+            counts[-1] += value
+
+    def _samples(self, key, counts):
+        names = self.label_names + ("le",)
+        lines = [f"{self.name}_bucket{_labels(names, key + (f'{bound:g}',))} {counts[index]}"
+                 for index, bound in enumerate(self.buckets)]
+        lines.append(f"{self.name}_bucket{_labels(names, key + ('+Inf',))} {counts[-2]}")
+        lines.append(f"{self.name}_sum{_labels(self.label_names, key)} {counts[-1]:g}")
+        lines.append(f"{self.name}_count{_labels(self.label_names, key)} {counts[-2]}")
+        return lines
+
+
+def render(registry):
+    """Renders every metric in the registry as Prometheus text (version 0.0.4)."""
+    lines = []
+    for metric in registry:
+        lines.extend(metric.render())
+    return "\n".join(lines) + "\n"
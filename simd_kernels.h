@@ -0,0 +1,384 @@
+/**
+ * SIMD Kernel Template
+ * Included by finance_engine.c once per x86 instruction set, between
+ * #pragma GCC push_options / target / pop_options, with:
+ *   KERNEL_WIDTH  - floats per vector register (4 SSE2, 8 AVX2, 16 AVX-512)
+ *   KERNEL_SUFFIX - token appended to every function name (sse2, avx2, avx512)
+ *
+ * The bodies are written with GCC vector extensions, so a single source compiles
+ * to each instruction set; intrinsics appear only where the extensions have no
+ * equivalent (byte movemask, lane compress, sqrt). Transcendentals come from
+ * simd_math.h. Every variant must produce the same
+ * results as its _scalar twin in finance_engine.c, up to floating-point summation
+ * order, and the RNG must be bit-identical.
+ */
+#define KERNEL_PASTE(name, suffix) name##_##suffix
+#define KERNEL_EXPAND(name, suffix) KERNEL_PASTE(name, suffix)
+#define KERNEL_NAME(name) KERNEL_EXPAND(name, KERNEL_SUFFIX)
+
+typedef float KERNEL_NAME(vfloat) __attribute__((vector_size(KERNEL_WIDTH * 4)));
+typedef float KERNEL_NAME(vhalf) __attribute__((vector_size(KERNEL_WIDTH * 2)));
+typedef double KERNEL_NAME(vdouble) __attribute__((vector_size(KERNEL_WIDTH * 4)));
+typedef uint32_t KERNEL_NAME(vuint) __attribute__((vector_size(KERNEL_WIDTH * 4)));
+typedef int32_t KERNEL_NAME(vint) __attribute__((vector_size(KERNEL_WIDTH * 4)));
+
+//Splits one float vector into halves that widen to a full double vector each.
+typedef union {
+    KERNEL_NAME(vfloat) whole;
+    KERNEL_NAME(vhalf) half[2];
+} KERNEL_NAME(vsplit);
+
+#include "simd_math.h"
+
+/**
+ * Delimiter scan: one compare per byte lane, folded into 64-bit position masks.
+ * Whole 64-byte blocks are vectorised; the ragged tail reuses the scalar kernel.
+ */
+static void KERNEL_NAME(scan_delimiters)(const char* buffer, size_t length, uint64_t* commas, uint64_t* newlines){
+    size_t blocks = length / 64;
+
+    for (size_t b = 0; b < blocks; b++){
+        const char *block = buffer + b * 64;
+#if KERNEL_WIDTH == 16
+        __m512i bytes = _mm512_loadu_si512((const void*)block);
+        commas[b] = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(','));
+        newlines[b] = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\n'));
+#elif KERNEL_WIDTH == 8
+        uint64_t comma_bits = 0;
+        uint64_t newline_bits = 0;
+        for (int offset = 0; offset < 64; offset += 32){
+            __m256i bytes = _mm256_loadu_si256((const __m256i*)(block + offset));
+            comma_bits |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(','))) << offset;
+            newline_bits |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'))) << offset;
+        }
+        commas[b] = comma_bits;
+        newlines[b] = newline_bits;
+#else
+        uint64_t comma_bits = 0;
+        uint64_t newline_bits = 0;
+        for (int offset = 0; offset < 64; offset += 16){
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(block + offset));
+            comma_bits |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(','))) << offset;
+            newline_bits |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))) << offset;
+        }
+        commas[b] = comma_bits;
+        newlines[b] = newline_bits;
+#endif
+    }
+#if KERNEL_WIDTH > 4
+    //The scalar tail is a sibling call, which GCC does not guard with vzeroupper; dirty upper
+    //lanes would make every later SSE instruction (libm's log() among them) many times slower.
+    _mm256_zeroupper();
+#endif
+    scan_delimiters_scalar(buffer + blocks * 64, length - blocks * 64, commas + blocks, newlines + blocks);
+}
+
+/**
+ * Sum in double precision: each float half-vector is widened before accumulating,
+ * exactly like the scalar loop's double accumulator, with two chains for ILP.
+ */
+static double KERNEL_NAME(sum)(const float* data, int count){
+    KERNEL_NAME(vdouble) acc0 = {0};
+    KERNEL_NAME(vdouble) acc1 = {0};
+    int i = 0;
+
+    for (; i + KERNEL_WIDTH <= count; i += KERNEL_WIDTH){
+        KERNEL_NAME(vsplit) x;
+        memcpy(&x.whole, data + i, sizeof(x.whole));
+        acc0 += __builtin_convertvector(x.half[0], KERNEL_NAME(vdouble));
+        acc1 += __builtin_convertvector(x.half[1], KERNEL_NAME(vdouble));
+    }
+    acc0 += acc1;
+    double total = 0;
+    for (int lane = 0; lane < KERNEL_WIDTH / 2; lane++){
+        total += acc0[lane];
+    }
+    for (; i < count; i++){
+        total += data[i];
+    }
+    return total;
+}
+
+/**
+ * Sum of squared deviations: the difference and square stay in float (as in
+ * stand_dev), only the accumulation is widened to double.
+ */
+static double KERNEL_NAME(sum_sq_dev)(const float* data, int count, float mean){
+    KERNEL_NAME(vdouble) acc0 = {0};
+    KERNEL_NAME(vdouble) acc1 = {0};
+    KERNEL_NAME(vfloat) center = mean - (KERNEL_NAME(vfloat)){0};
+    int i = 0;
+
+    for (; i + KERNEL_WIDTH <= count; i += KERNEL_WIDTH){
+        KERNEL_NAME(vsplit) x;
+        memcpy(&x.whole, data + i, sizeof(x.whole));
+        x.whole = (x.whole - center) * (x.whole - center);
+        acc0 += __builtin_convertvector(x.half[0], KERNEL_NAME(vdouble));
+        acc1 += __builtin_convertvector(x.half[1], KERNEL_NAME(vdouble));
+    }
+    acc0 += acc1;
+    double total = 0;
+    for (int lane = 0; lane < KERNEL_WIDTH / 2; lane++){
+        total += acc0[lane];
+    }
+    for (; i < count; i++){
+        total += (data[i] - mean) * (data[i] - mean);
+    }
+    return total;
+}
+
+/**
+ * xoshiro128+ over RNG_LANES lanes, KERNEL_WIDTH lanes per register.
+ * Each lane group keeps its state in registers across all rows, and writes
+ * out[row + lane] so the stream is identical to the scalar kernel's.
+ */
+static void KERNEL_NAME(uniforms)(EngineRng* rng, float* out, int count){
+    for (int lane = 0; lane < RNG_LANES; lane += KERNEL_WIDTH){
+        KERNEL_NAME(vuint) s0, s1, s2, s3;
+        memcpy(&s0, &rng->s[0][lane], sizeof(s0));
+        memcpy(&s1, &rng->s[1][lane], sizeof(s1));
+        memcpy(&s2, &rng->s[2][lane], sizeof(s2));
+        memcpy(&s3, &rng->s[3][lane], sizeof(s3));
+
+        for (int row = 0; row < count; row += RNG_LANES){
+            KERNEL_NAME(vuint) result = s0 + s3;
+            KERNEL_NAME(vuint) t = s1 << 9;
+            s2 ^= s0;
+            s3 ^= s1;
+            s1 ^= s2;
+            s0 ^= s3;
+            s2 ^= t;
+            s3 = (s3 << 11) | (s3 >> 21);
+            //Top 24 bits -> (0, 1], matching the old (rand()+1)/(RAND_MAX+1) range.
+            KERNEL_NAME(vfloat) u = __builtin_convertvector((KERNEL_NAME(vint))((result >> 8) + 1), KERNEL_NAME(vfloat))
+                                    * (1.0f / 16777216.0f);
+            memcpy(out + row + lane, &u, sizeof(u));
+        }
+
+        memcpy(&rng->s[0][lane], &s0, sizeof(s0));
+        memcpy(&rng->s[1][lane], &s1, sizeof(s1));
+        memcpy(&rng->s[2][lane], &s2, sizeof(s2));
+        memcpy(&rng->s[3][lane], &s3, sizeof(s3));
+    }
+}
+
+/**
+ * Box-Muller with vector log/sqrt/sincos, in the same slot layout as the scalar
+ * kernel: radius draws in lanes 0-15 of each block, angle draws in 16-31.
+ */
+static void KERNEL_NAME(box_muller)(const float* uniforms, float* out, int count, float mean, float deviation){
+    const int half = BOX_MULLER_BLOCK / 2;
+    for (int block = 0; block < count; block += BOX_MULLER_BLOCK){
+        for (int j = 0; j < half; j += KERNEL_WIDTH){
+            KERNEL_NAME(vfloat) u1;
+            KERNEL_NAME(vfloat) u2;
+            KERNEL_NAME(vfloat) sin_part;
+            KERNEL_NAME(vfloat) cos_part;
+            memcpy(&u1, uniforms + block + j, sizeof(u1));
+            memcpy(&u2, uniforms + block + half + j, sizeof(u2));
+            KERNEL_NAME(vfloat) gravity = KERNEL_NAME(vsqrt)(-2.0f * KERNEL_NAME(vlog)(u1));
+            KERNEL_NAME(vsincos)((float)(PI*2) * u2, &sin_part, &cos_part);
+            cos_part = gravity * cos_part * deviation + mean;
+            sin_part = gravity * sin_part * deviation + mean;
+            memcpy(out + block + j, &cos_part, sizeof(cos_part));
+            memcpy(out + block + half + j, &sin_part, sizeof(sin_part));
+        }
+    }
+}
+
+/**
+ * Normal density at each x, term for term as rieman() computes it; the ragged
+ * tail reuses the scalar kernel.
+ */
+static void KERNEL_NAME(gaussian_density)(const float* x, float* out, int count, float mean, float deviation){
+    const float scale = INV_SQRT_2PI/deviation;
+    int i = 0;
+
+    for (; i + KERNEL_WIDTH <= count; i += KERNEL_WIDTH){
+        KERNEL_NAME(vfloat) z;
+        memcpy(&z, x + i, sizeof(z));
+        z = (z - mean) / deviation;
+        z = scale * KERNEL_NAME(vexp)(-0.5f * (z * z));
+        memcpy(out + i, &z, sizeof(z));
+    }
+    gaussian_density_scalar(x + i, out + i, count - i, mean, deviation);
+}
+
+//Array forms of the vector math, so bench_engine can time and score them against libm.
+static void KERNEL_NAME(log_array)(const float* in, float* out, int count){
+    int i = 0;
+    for (; i + KERNEL_WIDTH <= count; i += KERNEL_WIDTH){
+        KERNEL_NAME(vfloat) v;
+        memcpy(&v, in + i, sizeof(v));
+        v = KERNEL_NAME(vlog)(v);
+        memcpy(out + i, &v, sizeof(v));
+    }
+    log_array_scalar(in + i, out + i, count - i);
+}
+
+static void KERNEL_NAME(exp_array)(const float* in, float* out, int count){
+    int i = 0;
+    for (; i + KERNEL_WIDTH <= count; i += KERNEL_WIDTH){
+        KERNEL_NAME(vfloat) v;
+        memcpy(&v, in + i, sizeof(v));
+        v = KERNEL_NAME(vexp)(v);
+        memcpy(out + i, &v, sizeof(v));
+    }
+    exp_array_scalar(in + i, out + i, count - i);
+}
+
+static void KERNEL_NAME(sincos_array)(const float* in, float* sin_out, float* cos_out, int count){
+    int i = 0;
+    for (; i + KERNEL_WIDTH <= count; i += KERNEL_WIDTH){
+        KERNEL_NAME(vfloat) v;
+        KERNEL_NAME(vfloat) s;
+        KERNEL_NAME(vfloat) c;
+        memcpy(&v, in + i, sizeof(v));
+        KERNEL_NAME(vsincos)(v, &s, &c);
+        memcpy(sin_out + i, &s, sizeof(s));
+        memcpy(cos_out + i, &c, sizeof(c));
+    }
+    sincos_array_scalar(in + i, sin_out + i, cos_out + i, count - i);
+}
+
+static void KERNEL_NAME(sqrt_array)(const float* in, float* out, int count){
+    int i = 0;
+    for (; i + KERNEL_WIDTH <= count; i += KERNEL_WIDTH){
+        KERNEL_NAME(vfloat) v;
+        memcpy(&v, in + i, sizeof(v));
+        v = KERNEL_NAME(vsqrt)(v);
+        memcpy(out + i, &v, sizeof(v));
+    }
+    sqrt_array_scalar(in + i, out + i, count - i);
+}
+
+#if KERNEL_WIDTH >= 8
+#if KERNEL_WIDTH == 8
+//Left-pack permutation for every 8-bit lane mask (AVX2 has no compress instruction).
+static int32_t select_pack_table[256][8] __attribute__((aligned(32)));
+static int select_pack_ready = 0;
+
+static void select_pack_init(void){
+    for (int mask = 0; mask < 256; mask++){
+        int next = 0;
+        for (int lane = 0; lane < 8; lane++){
+            if (mask & (1 << lane)){
+                select_pack_table[mask][next++] = lane;
+            }
+        }
+        while (next < 8){
+            select_pack_table[mask][next++] = 0;
+        }
+    }
+    select_pack_ready = 1;
+}
+#endif
+
+/**
+ * Appends the lanes of 'values' selected by 'mask' at dst, returning how many.
+ * A full register is stored, so dst must have KERNEL_WIDTH writable slots; the
+ * partition loop guarantees that (see KERNEL_NAME(select)).
+ */
+static inline int KERNEL_NAME(compress_store)(float* dst, KERNEL_NAME(vfloat) values, unsigned mask){
+#if KERNEL_WIDTH == 16
+    _mm512_mask_compressstoreu_ps(dst, (__mmask16)mask, (__m512)values);
+#else
+    __m256i order = _mm256_load_si256((const __m256i*)select_pack_table[mask]);
+    _mm256_storeu_ps(dst, _mm256_permutevar8x32_ps((__m256)values, order));
+#endif
+    return __builtin_popcount(mask);
+}
+
+static inline unsigned KERNEL_NAME(mask_less)(KERNEL_NAME(vfloat) a, KERNEL_NAME(vfloat) b){
+#if KERNEL_WIDTH == 16
+    return _mm512_cmp_ps_mask((__m512)a, (__m512)b, _CMP_LT_OQ);
+#else
+    return _mm256_movemask_ps(_mm256_cmp_ps((__m256)a, (__m256)b, _CMP_LT_OQ));
+#endif
+}
+
+/**
+ * Quickselect with a vectorised three-way partition.
+ * Each pass streams the current range once, compress-storing values below the
+ * pivot into one buffer and values above it into another; values equal to the
+ * pivot are only counted. Three scratch buffers rotate so a pass never writes the
+ * range it reads; the first pass reads data and nothing writes it, so data is left
+ * as given (a trivial reordering). Small ranges finish in the scalar kernel.
+ */
+static float KERNEL_NAME(select)(float* data, int count, int k){
+    if (count <= SELECT_SCALAR_CUTOFF){
+        return select_scalar(data, count, k);
+    }
+#if KERNEL_WIDTH == 8
+    if (!select_pack_ready){
+        select_pack_init();
+    }
+#endif
+    float *scratch = malloc(sizeof(float) * count * 3);
+    if (scratch == NULL){
+        return select_scalar(data, count, k);
+    }
+    //Slot 0 stands in for data on the first pass, so lows and highs land in slots 1 and 2.
+    float *buffers[3] = {scratch, scratch + count, scratch + 2 * count};
+    int source = 0;
+    float *src = data;
+    int n = count;
+    float result;
+
+    for (;;){
+        if (n <= SELECT_SCALAR_CUTOFF){
+            result = select_scalar(src, n, k);
+            break;
+        }
+        //Median of three spread samples keeps the pivot away from the extremes.
+        float a = src[n / 4];
+        float b = src[n / 2];
+        float c = src[(3 * n) / 4];
+        float pivot = (a < b) ? ((b < c) ? b : ((a < c) ? c : a)) : ((a < c) ? a : ((b < c) ? c : b));
+
+        float *lows = buffers[(source + 1) % 3];
+        float *highs = buffers[(source + 2) % 3];
+        int low_count = 0;
+        int high_count = 0;
+        KERNEL_NAME(vfloat) pivots = pivot - (KERNEL_NAME(vfloat)){0};
+        int i = 0;
+        //Stores never overrun: at most i values were written before lane i, and i + WIDTH <= n.
+        for (; i + KERNEL_WIDTH <= n; i += KERNEL_WIDTH){
+            KERNEL_NAME(vfloat) values;
+            memcpy(&values, src + i, sizeof(values));
+            low_count += KERNEL_NAME(compress_store)(lows + low_count, values, KERNEL_NAME(mask_less)(values, pivots));
+            high_count += KERNEL_NAME(compress_store)(highs + high_count, values, KERNEL_NAME(mask_less)(pivots, values));
+        }
+        for (; i < n; i++){
+            if (src[i] < pivot){
+                lows[low_count++] = src[i];
+            }
+            else if (src[i] > pivot){
+                highs[high_count++] = src[i];
+            }
+        }
+
+        if (k < low_count){
+            source = (source + 1) % 3;
+            src = lows;
+            n = low_count;
+        }
+        else if (k >= n - high_count){
+            k -= n - high_count;
+            source = (source + 2) % 3;
+            src = highs;
+            n = high_count;
+        }
+        else{
+            result = pivot;
+            break;
+        }
+    }
+    free(scratch);
+    return result;
+}
+#endif
+
+#undef KERNEL_NAME
+#undef KERNEL_EXPAND
+#undef KERNEL_PASTE
@@ -0,0 +1,139 @@
+/**
+ * CSV PRE-PARSER (Web Worker)
+ * Parses a "type,return" CSV off the main thread and answers with a column upload: the
+ * binary layout the C-Engine loads without any text parsing (ColumnHeader/ColumnBlock in
+ * finance_engine.c). Rows are read the way the engine reads them: the type runs up to the
+ * first comma (stopping at '\r', truncated to 19 bytes), lines without a comma or with an
+ * empty type are skipped, and a value that does not parse counts as 0, as atof() would.
+ *
+ *   header  magic "RISKCOL\0", uint32 version, uint32 block count, uint64 row count
+ *   block   char[20] type (NUL-padded), uint32 count, then count float32 returns
+ *
+ * Everything is little-endian. Message in: a File. Message out: { buffer, rows, symbols }
+ * with the buffer transferred, or { error }.
+ */
+const COLUMNS_MAGIC = [0x52, 0x49, 0x53, 0x4b, 0x43, 0x4f, 0x4c, 0x00];
+const COLUMNS_VERSION = 1;
+const HEADER_SIZE = 24;
+const BLOCK_SIZE = 24;
+const NAME_SIZE = 20;
+
+const encoder = new TextEncoder();
+
+/**
+ * GROWABLE COLUMN
+ * One symbol's returns in a Float32Array that doubles when full.
+ */
+class Column {
+    constructor(name) {
+        this.name = name;
+        this.values = new Float32Array(1024);
+        this.count = 0;
+    }
+
+    push(value) {
+        if (this.count === this.values.length) {
+            const grown = new Float32Array(this.values.length * 2);
+            grown.set(this.values);
+            this.values = grown;
+        }
+        this.values[this.count++] = value;
+    }
+}
+
+/**
+ * LINE PARSER
+ * Adds one CSV line to its symbol's column.
+ */
+function parseLine(line, columns) {
+    const comma = line.indexOf(',');
+    if (comma < 0) {
+        return 0;
+    }
+    let end = line.indexOf('\r');
+    if (end < 0 || end > comma) {
+        end = comma;
+    }
+    if (end === 0) {
+        return 0;
+    }
+    // NAME TRUNCATION: The engine keeps the first 19 bytes of the type.
+    const name = encoder.encode(line.slice(0, end)).subarray(0, NAME_SIZE - 1);
+    const key = String.fromCharCode(...name);
+    let column = columns.get(key);
+    if (column === undefined) {
+        column = new Column(name);
+        columns.set(key, column);
+    }
+    const value = parseFloat(line.slice(comma + 1));
+    column.push(Number.isNaN(value) ? 0 : value);
+    return 1;
+}
+
+/**
+ * SERIALIZATION
+ * Lays the columns out as one column upload, a block per symbol in first-seen order.
+ */
+function encode(columns, rows) {
+    let size = HEADER_SIZE;
+    for (const column of columns.values()) {
+        size += BLOCK_SIZE + 4 * column.count;
+    }
+    const buffer = new ArrayBuffer(size);
+    const bytes = new Uint8Array(buffer);
+    const view = new DataView(buffer);
+
+    bytes.set(COLUMNS_MAGIC, 0);
+    view.setUint32(8, COLUMNS_VERSION, true);
+    view.setUint32(12, columns.size, true);
+    view.setBigUint64(16, BigInt(rows), true);
+
+    let offset = HEADER_SIZE;
+    for (const column of columns.values()) {
+        bytes.set(column.name, offset);
+        view.setUint32(offset + NAME_SIZE, column.count, true);
+        offset += BLOCK_SIZE;
+        // ENDIANNESS: Bulk copy where the host is little-endian (every mainstream browser).
+        if (new Uint8Array(new Float32Array([1]).buffer)[3] === 0x3f) {
+            bytes.set(new Uint8Array(column.values.buffer, 0, 4 * column.count), offset);
+        } else {
+            for (let i = 0; i < column.count; i++) {
+                view.setFloat32(offset + 4 * i, column.values[i], true);
+            }
+        }
+        offset += 4 * column.count;
+    }
+    return buffer;
+}
+
+/**
+ * STREAMING READ
+ * Decodes the file chunk by chunk, so the text is never held in memory whole; a line
+ * cut by a chunk boundary is carried into the next chunk.
+ */
+self.onmessage = async function(event) {
+    try {
+        const columns = new Map();
+        let rows = 0;
+        let carry = '';
+        const reader = event.data.stream().pipeThrough(new TextDecoderStream()).getReader();
+        for (;;) {
+            const { value, done } = await reader.read();
+            if (done) {
+                break;
+            }
+            const lines = (carry + value).split('\n');
+            carry = lines.pop();
+            for (const line of lines) {
+                rows += parseLine(line, columns);
+            }
+        }
+        // The final line of a file may lack its newline.
+        rows += parseLine(carry, columns);
+
+        const buffer = encode(columns, rows);
+        self.postMessage({ buffer: buffer, rows: rows, symbols: columns.size }, [buffer]);
+    } catch (error) {
+        self.postMessage({ error: String(error) });
+    }
+};
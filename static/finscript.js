@@ -9,6 +9,148 @@ const terminal = document.getElementById('terminal-text');
 const mean = document.getElementById('mean-overview');
 const stability = document.getElementById('stability-overview');
 const worst_case = document.getElementById('worstcase-overview');
+const file_upload = document.getElementById('file-upload');
+const histogram_canvas = document.getElementById('histogram-canvas');
+const compare = document.getElementById('compareButton');
+const compare_cards = document.getElementById('compare-cards');
+
+/**
+ * DATASET REGISTRATION
+ * Uploads the CSV once, as soon as it is picked; every later run names the returned
+ * dataset ID instead of re-sending the file. Where Web Workers exist the CSV is parsed
+ * in the browser and only the float32 returns are sent (several times smaller, and the
+ * engine skips text parsing); otherwise, or if that fails, the raw file is sent.
+ */
+let datasetId = null;
+let datasetUpload = null;
+
+function registerColumns(file){
+    return new Promise((resolve, reject) => {
+        const worker = new Worker('/static/csv_worker.js');
+        worker.onmessage = event => {
+            worker.terminate();
+            if (event.data.error) {
+                reject(new Error(event.data.error));
+            } else {
+                resolve(event.data.buffer);
+            }
+        };
+        worker.onerror = error => {
+            worker.terminate();
+            reject(error);
+        };
+        worker.postMessage(file);
+    }).then(buffer => fetch('/datasets/columns', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/octet-stream' },
+        body: buffer
+    })).then(response => {
+        if (!response.ok) {
+            throw new Error(`column upload rejected (${response.status})`);
+        }
+        return response.json();
+    });
+}
+
+/**
+ * UPLOAD COMPRESSION
+ * Return files are repetitive text and compress several-fold, which matters over slow
+ * links. Where CompressionStream exists the file is gzipped as it is read; the server
+ * stores the bytes as they are and the engine inflates them while parsing.
+ */
+function compressed(file){
+    if (!window.CompressionStream) {
+        return Promise.resolve(file);
+    }
+    const stream = file.stream().pipeThrough(new CompressionStream('gzip'));
+    return new Response(stream).blob()
+        .then(blob => new File([blob], `${file.name}.gz`, { type: 'application/gzip' }))
+        .catch(() => file);
+}
+
+function registerCsv(file){
+    return compressed(file).then(payload => {
+        const upload = new FormData();
+        upload.append('file_input_name', payload);
+        return fetch('/datasets', { method: 'POST', body: upload });
+    }).then(response => response.ok ? response.json() : null);
+}
+
+file_upload.addEventListener('change', function(){
+    datasetId = null;
+    datasetUpload = null;
+    if (!file_upload.files.length) {
+        return;
+    }
+    const file = file_upload.files[0];
+    const registration = window.Worker ? registerColumns(file).catch(() => registerCsv(file)) : registerCsv(file);
+    datasetUpload = registration
+        .then(data => {
+            datasetId = data ? data.dataset_id : null;
+            return datasetId;
+        })
+        .catch(() => null);
+});
+
+/**
+ * RUN REQUEST
+ * POSTs by dataset ID when one is registered; if the server has evicted it (404),
+ * falls back to sending the full form, file included.
+ */
+function requestResult(id){
+    const formdata = new FormData(form);
+    formdata.delete('file_input_name');
+    let packaged;
+    if (id) {
+        formdata.append('dataset_id', id);
+        packaged = Promise.resolve(formdata);
+    } else if (file_upload.files.length) {
+        packaged = compressed(file_upload.files[0]).then(payload => {
+            formdata.append('file_input_name', payload);
+            return formdata;
+        });
+    } else {
+        packaged = Promise.resolve(formdata);
+    }
+    return packaged.then(body => fetch('/result', { method: 'POST', body: body })).then(response => {
+        if (id && response.status === 404) {
+            datasetId = null;
+            return requestResult(null);
+        }
+        return response;
+    });
+}
+
+/**
+ * DISTRIBUTION CHART
+ * Draws the engine's histogram of simulated returns as bars scaled to the tallest bin,
+ * with the 5% quantile (the Monte Carlo worst case) as a red line. The engine bins the
+ * samples while generating them, so only the counts cross the wire.
+ */
+function drawHistogram(canvas, histogram){
+    const context = canvas.getContext('2d');
+    context.clearRect(0, 0, canvas.width, canvas.height);
+    if (!histogram || !histogram.counts.length) {
+        return;
+    }
+    const counts = histogram.counts;
+    const tallest = Math.max(...counts) || 1;
+    const width = canvas.width / counts.length;
+    context.fillStyle = '#0dcaf0';
+    counts.forEach((count, bin) => {
+        const height = canvas.height * count / tallest;
+        context.fillRect(bin * width, canvas.height - height, Math.max(width - 1, 1), height);
+    });
+    // VAR MARKER: Placed by value on the same [low, high) axis as the bins.
+    const x = canvas.width * (histogram.var - histogram.low) / (histogram.high - histogram.low);
+    if (x >= 0 && x <= canvas.width) {
+        context.strokeStyle = '#dc3545';
+        context.beginPath();
+        context.moveTo(x, 0);
+        context.lineTo(x, canvas.height);
+        context.stroke();
+    }
+}
 
 /**
  * SIMULATION EVENT LISTENER
@@ -26,20 +168,12 @@ submit.addEventListener('click', function(e){
     inner_bar.style.width = '100%';
     inner_bar.classList.add('probar_trans');
 
-    /**
-     * DATA PACKAGING
-     * Encapsulating the CSV file and metadata into a FormData object for binary transmission.
-     */
-    const formdata = new FormData(form);
-
     /**
      * ASYNCHRONOUS BRIDGE (Fetch API)
-     * POSTing the payload to the Flask /result endpoint.
+     * Waiting for any in-flight registration, then POSTing to the Flask /result endpoint.
      */
-    fetch('/result', {
-        method: 'POST',
-        body: formdata
-    })
+    Promise.resolve(datasetUpload)
+    .then(() => requestResult(datasetId))
     // DATA UNPACKING: Converting the raw HTTP response into a usable JSON object.
     .then(response => response.json())
     .then(data => {
@@ -70,6 +204,7 @@ submit.addEventListener('click', function(e){
         // Final Text Update for Stability Card
         stability.innerText = data.stability;
         worst_case.innerText = `${data.min} - ${data.max}`;
+        drawHistogram(histogram_canvas, data.histogram);
 
         /**
          * TERMINAL LOG SIMULATION
@@ -106,3 +241,91 @@ submit.addEventListener('click', function(e){
         console.error('Fetch error:', error);
     })
 });
+
+/**
+ * BATCH REQUEST
+ * Same dataset-ID-first strategy as requestResult(), against /batch. An empty 'types'
+ * asks for every asset in the file.
+ */
+function requestBatch(id, types){
+    const formdata = new FormData();
+    formdata.append('types', types.join(','));
+    let packaged;
+    if (id) {
+        formdata.append('dataset_id', id);
+        packaged = Promise.resolve(formdata);
+    } else if (file_upload.files.length) {
+        packaged = compressed(file_upload.files[0]).then(payload => {
+            formdata.append('file_input_name', payload);
+            return formdata;
+        });
+    } else {
+        packaged = Promise.resolve(formdata);
+    }
+    return packaged.then(body => fetch('/batch', { method: 'POST', body: body })).then(response => {
+        if (id && response.status === 404) {
+            datasetId = null;
+            return requestBatch(null, types);
+        }
+        return response;
+    });
+}
+
+/**
+ * COMPARISON CARD
+ * One asset's figures and distribution, built from the same fields as the single view.
+ */
+function compareCard(result){
+    const column = document.createElement('div');
+    column.className = 'col';
+    const card = document.createElement('div');
+    card.className = 'card h-100';
+    const body = document.createElement('div');
+    body.className = 'card-body p-2';
+    const title = document.createElement('h6');
+    title.innerText = result.type;
+    body.appendChild(title);
+    if (result.error) {
+        const note = document.createElement('small');
+        note.innerText = result.error;
+        body.appendChild(note);
+    } else {
+        [['Average Return', result.mean], ['Stability Score', result.stability],
+         ['Worst Case', `${result.min} - ${result.max}`]].forEach(([label, value]) => {
+            const line = document.createElement('div');
+            line.innerText = `${label}: ${value}`;
+            body.appendChild(line);
+        });
+        const canvas = document.createElement('canvas');
+        canvas.width = 240;
+        canvas.height = 80;
+        canvas.className = 'w-100';
+        body.appendChild(canvas);
+        drawHistogram(canvas, result.histogram);
+    }
+    card.appendChild(body);
+    column.appendChild(card);
+    return column;
+}
+
+/**
+ * COMPARISON EVENT LISTENER
+ * Fetches every asset of the uploaded file in one /batch round trip (one engine run)
+ * and lays the results out side by side.
+ */
+compare.addEventListener('click', function(){
+    progress_bar.classList.remove('d-none');
+    Promise.resolve(datasetUpload)
+    .then(() => requestBatch(datasetId, []))
+    .then(response => response.json())
+    .then(data => {
+        compare_cards.replaceChildren(...(data.results || []).map(compareCard));
+        terminal.innerText = data.error ? `[ERROR]: ${data.error}\n`
+            : `[BATCH]: ${data.results.length} assets analysed in one request.\n`;
+    })
+    .catch(error => {
+        console.error('Fetch error:', error);
+    })
+    .finally(() => progress_bar.classList.add('d-none'));
+});
+
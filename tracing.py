@@ -0,0 +1,58 @@
+"""
+REQUEST TRACING
+Spans for one request share a trace ID generated in response(): the Python side records
+upload, save, engine and response spans, and the engine (run with --trace ID) reports its
+own phases, which are forwarded here unchanged. Every span is one JSON line in a local
+sink file, so grepping a slow request's ID yields its whole waterfall:
+
+    {"trace_id": ..., "name": ..., "parent": ..., "start_unix_ns": ..., "duration_ns": ..., ...}
+
+Starts are wall-clock nanoseconds (the engine converts its monotonic stamps) so Python and
+engine spans line up; durations are monotonic.
+"""
+import json
+import os
+import threading
+import time
+from contextlib import contextmanager
+
+
+def new_trace_id():
+    """A random 128-bit trace ID as 32 hex characters (the engine accepts token characters only)."""
+    return os.urandom(16).hex()
+
+
+class SpanSink:
+    """
+    JSON-LINES SPAN SINK
+    Appends spans to a file, one line per write. The file is opened in append mode, so
+    several worker processes can share it; a path of "" disables tracing.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self._lock = threading.Lock()
+        self._handle = None
+
+    def write(self, span):
+        if not self.path:
+            return
+        line = json.dumps(span, separators=(",", ":")) + "\n"
+        with self._lock:
+            if self._handle is None:
+                self._handle = open(self.path, "a", buffering=1)
+            self._handle.write(line)
+
+    @contextmanager
+    def span(self, trace_id, name, parent="request", **attributes):
+        """Times the enclosed block as one span; an escaping exception is recorded on it."""
+        start_unix_ns = time.time_ns()
+        start = time.perf_counter_ns()
+        try:
+            yield attributes
+        except Exception as error:
+            attributes["error"] = type(error).__name__
+            raise
+        finally:
+            self.write({"trace_id": trace_id, "name": name, "parent": parent, "start_unix_ns": start_unix_ns,
+                        "duration_ns": time.perf_counter_ns() - start, **attributes})